@@ -14,12 +14,30 @@
  /*---------------------------[ Public Functions ]----------------------------
  *
  * int m_mread(addr,buff)            multiple read i=0..15
+ * int m_readburst(base,index,       sequential read of a word range
+ *                 count,buff)
  * int m_mwrite(addr,buff)           multiple write i=0..15
+ * int m_mwritex(addr,buff,flags)    multiple write with write flags
  * int m_read(addr,index)            single read i
  * int m_write(addr,index,data)      single write i
+ * int m_writex(addr,index,data,     single write with write flags
+ *              flags)
+ * int m_writerange(addr,index,      write a word range in one session
+ *                  count,buff,flags)
+ * int m_writeall(addr,buff,flags)   program whole EEPROM (ERAL/WRAL)
  * int m_getmodinfo(base,modtype,    get module information
  *                  devid,devrev,
  *                  devname)
+ * void m_cacheflush(base)           flush id-prom cache
+ * int m_readmulti(bases,n,index,    read a word range of n modules
+ *                 count,buff)       in lockstep
+ * int m_scanmodinfo(bases,n)        read id-prom data of n modules
+ *                                   in lockstep into the cache
+ * void m_cachestat(hitsP,missesP)   get id-prom cache counters
+ * int m_writestart(job,addr,index,  start non-blocking write of a word
+ *                  count,buff,flags) range (see ID_WriteStep())
+ * int m_writemulti(bases,n,index,   write a word range to several
+ *         count,buff,flags,errors)  modules concurrently
  *
  *---------------------------------------------------------------------------
  * Copyright 1993-2019, MEN Mikro Elektronik GmbH
@@ -46,11 +64,11 @@
 #include <MEN/oss.h>
 #include <MEN/maccess.h>
 #include <MEN/modcom.h>
+#include "id_ext.h"
+#include "id_int.h"
 
 static const char IdentString[]=MENT_XSTR(MAK_REVISION);
 
-#define DELAY   20	                /* m_clock's delay time */
-
 /* id defines */
 #define MOD_ID_MAGIC	0x5346  /* M-Module id prom magic word */
 #define MOD_ID_MS_MASK	0x5300	/* mask to indicate MSxx M-Module */
@@ -65,25 +83,72 @@ static const char IdentString[]=MENT_XSTR(MAK_REVISION);
 #define     WRAL    0x10    /* chip write */
 #define     EWDS    0x00    /* disable erase/write state */
 
-#define     T_WP    10000   /* max. time required for write/erase (us) */
-
-/* bit definition */
-#define B_DAT	0x01				/* data in-;output		*/
-#define B_CLK	0x02				/* clock				*/
-#define B_SEL	0x04				/* chip-select			*/
-
 /* A08 register address */
 #define     MODREG  0xfe
 
+/* id-prom cache */
+#define     CACHE_SIZE  16      /* cached modules */
+
+/* non-blocking write (ID_AWRITE.state) */
+#define     AW_NEXT     0       /* program next word */
+#define     AW_ERASING  1       /* wait for end of ERASE */
+#define     AW_WRITING  2       /* wait for end of WRITE */
+#define     AW_DONE     3       /* finished, job->error valid */
+
+#define     WRITE_GROUP 8       /* modules programmed concurrently */
+#define     READ_GROUP  16      /* modules read in lockstep */
+
+/*--- typedefs ---*/
+typedef struct {
+    u_int32         valid;      /* entry used */
+    U_INT32_OR_64   base;       /* module base */
+    u_int16         magic;      /* word 0 */
+    u_int16         modid;      /* word 1 */
+    u_int16         layout;     /* word 2 */
+    u_int16         variant;    /* word 8 */
+} CACHE_ENTRY;
+
+/*--- statics ---*/
+static CACHE_ENTRY  G_cache[CACHE_SIZE];    /* m_getmodinfo() cache */
+static u_int32      G_cacheNext;            /* next entry to replace */
+static u_int32      G_cacheHits;
+static u_int32      G_cacheMisses;
+
 /*--- K&R prototypes ---*/
-static int _write( U_INT32_OR_64 base, u_int8 index, u_int16 data );
-static int _erase( U_INT32_OR_64 base, u_int8 index );
-static void _opcode( U_INT32_OR_64 base, u_int8 code );
-static void _select( U_INT32_OR_64 base );
-static void _deselect( U_INT32_OR_64 base );
-static int _clock( U_INT32_OR_64 base, u_int8 dbs );
+static int _writesession( ID_BUS *bus, u_int8 index, u_int8 count,
+                          u_int16 *buff, u_int32 flags, u_int32 *writtenP );
+static int _writeall( ID_BUS *bus, u_int16 *buff, u_int32 flags );
+static int _erasecell( ID_BUS *bus, u_int8 index );
+static int _writecell( ID_BUS *bus, u_int8 code, u_int16 data );
+static int _mstep( ID_AWRITE *job );
+static int _awstep( ID_BUS *bus, ID_AWRITE *job );
+static int _awerror( ID_BUS *bus, ID_AWRITE *job, int error );
+static int _waitready( ID_BUS *bus );
 static void _delay( void );
 static void _xtoa( u_int32 val, u_int32 radix, char *buf );
+static CACHE_ENTRY *_cachefind( U_INT32_OR_64 base );
+static void _cachestore( U_INT32_OR_64 base, u_int16 magic, u_int16 modid,
+                         u_int16 layout, u_int16 variant );
+static u_int32 _mlock( U_INT32_OR_64 *bases, u_int32 n );
+static void _mreadburst( U_INT32_OR_64 *bases, u_int32 n, u_int8 index,
+                         u_int8 count, u_int16 *buff );
+
+/*--- Microwire engine on the module register (see id_mw.h),
+      inline 16-bit accesses of the fixed MODREG. The line state is
+      driven on all <slots> buses of a lockstep group (see _mreadburst()),
+      DO is sampled on the first one. ---*/
+#define ID_MW_HDL				ID_BUS
+#define ID_MW_OUT(h,state)									\
+	do {													\
+		ID_BUS *_b = (h), *_e = (h) + (h)->slots;			\
+		do ID_BUS_WRITE_D16( _b, MODREG, state );			\
+		while( ++_b < _e );									\
+	} while(0)
+#define ID_MW_IN(h)				(ID_BUS_READ_D16( h, MODREG ) & B_DAT)
+#define ID_MW_DELAY(h)			_delay()
+#define ID_MW_CODEBITS(h)		8
+#define ID_MW_READ(h,index)		(_READ_+(index))
+#include "id_mw.h"
 
 /******************************* m_mread ***********************************/
 /**   Read all contents (words 0..15) from EEPROM at 'base'.
@@ -96,11 +161,39 @@ static void _xtoa( u_int32 val, u_int32 radix, char *buf );
  ****************************************************************************/
 int m_mread( u_int8   *addr, u_int16  *buff )
 {
+    ID_BUS  bus;
+
+    ID_BusOpen( &bus, (U_INT32_OR_64)addr, MODREG );
+    _readburst( &bus, 0, 16, buff );
+    ID_BusClose( &bus );
+    return 0;
+}
+
+/******************************* m_readburst *******************************/
+/**   Read a range of words from EEPROM at 'base' in one transaction.
+ *
+ *    The READ opcode is sent only once for the first word. The EEPROM
+ *    then increments its address internally and the data of the
+ *    following words is clocked out continuously (sequential read).
+ *
+ *---------------------------------------------------------------------------
+ *  \param base			\IN base address pointer
+ *  \param index		\IN first index to read (0..63)
+ *  \param count		\IN number of words to read (1..64)
+ *  \param buff			\OUT user buffer (count words)
+ *  \return   0=ok, 1=error
+ *
+ ****************************************************************************/
+int m_readburst( U_INT32_OR_64 base, u_int8 index, u_int8 count, u_int16 *buff )
+{
+    ID_BUS  bus;
 
-    register u_int8    index;
+    if( count == 0 || (index + count) > ID_MOD_EEPROM_WORDS )
+        return 1;
 
-    for(index=0; index<16; index++)
-        *buff++ = (u_int16)m_read( (U_INT32_OR_64)addr, index);
+    ID_BusOpen( &bus, base, MODREG );
+    _readburst( &bus, index, count, buff );
+    ID_BusClose( &bus );
     return 0;
 }
 
@@ -115,14 +208,96 @@ int m_mread( u_int8   *addr, u_int16  *buff )
  ****************************************************************************/
 int m_mwrite( u_int8  *addr, u_int16 *buff )
 {
-    register u_int8    index;
+    return m_mwritex( addr, buff, 0 );
+}
 
-    for(index=0; index<16; index++)
-        if( m_write(addr,index,*buff++) )
-            return 1;
-    return 0;
+/******************************* m_mwritex *********************************/
+/**   Write all contents (words 0..15) into EEPROM at 'base'.
+ *
+ *    Same as m_mwrite() but with write flags (see m_writex()).
+ *
+ *---------------------------------------------------------------------------
+ *  \param addr		\IN base address pointer
+ *  \param buff		\IN user buffer (16 words)
+ *  \param flags	\IN write flags (ID_WF_xxx)
+ *  \return   0=ok, 1=error
+ *
+ ****************************************************************************/
+int m_mwritex( u_int8  *addr, u_int16 *buff, u_int32 flags )
+{
+    ID_BUS  bus;
+    int     error;
+
+    ID_BusOpen( &bus, (U_INT32_OR_64)addr, MODREG );
+    error = _writesession( &bus, 0, 16, buff, flags, NULL );
+    ID_BusClose( &bus );
+
+    return error ? 1 : 0;
 }
 
+/******************************* m_writerange ******************************/
+/**   Write a range of words into EEPROM at 'base' in one write session.
+ *
+ *    Erase/write is enabled only once for all words and disabled again
+ *    at the end, also if an error occurs.
+ *    With ID_WF_DIFF the range is burst read first and only the words
+ *    that differ from the buffer are programmed.
+ *
+ *---------------------------------------------------------------------------
+ *  \param addr		\IN base address pointer
+ *  \param index	\IN first index to write (0..63)
+ *  \param count	\IN number of words to write (1..64)
+ *  \param buff		\IN user buffer (count words)
+ *  \param flags	\IN write flags (ID_WF_xxx)
+ *  \param writtenP	\OUT number of words programmed (may be NULL)
+ *  \return   0=ok; 1=write err; 2=verify err; 3=erase err; 4=illegal range
+ *
+ ****************************************************************************/
+int m_writerange( u_int8 *addr, u_int8 index, u_int8 count, u_int16 *buff,
+                  u_int32 flags, u_int32 *writtenP )
+{
+    ID_BUS  bus;
+    int     error;
+
+    if( writtenP )
+        *writtenP = 0;
+
+    if( count == 0 || (index + count) > ID_MOD_EEPROM_WORDS )
+        return 4;
+
+    ID_BusOpen( &bus, (U_INT32_OR_64)addr, MODREG );
+    error = _writesession( &bus, index, count, buff, flags, writtenP );
+    ID_BusClose( &bus );
+
+    return error;
+}
+
+
+/******************************* m_writeall ********************************/
+/**   Program the whole EEPROM (words 0..63) at 'base'.
+ *
+ *    Uses ERAL to erase the device in one cycle and WRAL to write the
+ *    dominant fill value of the image (if not 0xFFFF), then programs
+ *    only the words that differ from the fill value.
+ *
+ *---------------------------------------------------------------------------
+ *  \param addr			\IN base address pointer
+ *  \param buff			\IN image (64 words)
+ *  \param flags		\IN write flags (ID_WF_xxx)
+ *  \return   0=ok; 1=write err; 2=verify err; 3=erase err
+ *
+ ****************************************************************************/
+int m_writeall( u_int8 *addr, u_int16 *buff, u_int32 flags )
+{
+    ID_BUS  bus;
+    int     error;
+
+    ID_BusOpen( &bus, (U_INT32_OR_64)addr, MODREG );
+    error = _writeall( &bus, buff, flags );
+    ID_BusClose( &bus );
+
+    return error;
+}
 
 /******************************* m_write ***********************************/
 /**   Write a specified word into EEPROM at 'base'.
@@ -136,10 +311,36 @@ int m_mwrite( u_int8  *addr, u_int16 *buff )
  ***************************************************************************/
 int m_write( u_int8 *addr, u_int8  index, u_int16 data )
 {
-    if( _erase( (U_INT32_OR_64)addr, index ))              /* erase cell first */
-        return 3;
+    return m_writex( addr, index, data, 0 );
+}
 
-    return _write( (U_INT32_OR_64)addr, index, data );
+/******************************* m_writex **********************************/
+/**   Write a specified word into EEPROM at 'base' with write flags.
+ *
+ *    ID_WF_NOERASE skips the explicit ERASE cycle. Use it only for
+ *    EEPROMs whose WRITE instruction erases the cell itself
+ *    (self-timed erase/write cycle as on the 93C46 family).
+ *    ID_WF_DIFF reads the word first and skips programming if it
+ *    already holds the data.
+ *
+ *---------------------------------------------------------------------------
+ *  \param addr			\IN base address pointer
+ *  \param index		\IN index to write (0..15)
+ *  \param data			\IN word to write
+ *  \param flags		\IN write flags (ID_WF_xxx)
+ *  \return   0=ok; 1=write err; 2=verify err; 3=erase err
+ *
+ ***************************************************************************/
+int m_writex( u_int8 *addr, u_int8  index, u_int16 data, u_int32 flags )
+{
+    ID_BUS  bus;
+    int     error;
+
+    ID_BusOpen( &bus, (U_INT32_OR_64)addr, MODREG );
+    error = _writesession( &bus, index, 1, &data, flags, NULL );
+    ID_BusClose( &bus );
+
+    return error;
 }
 
 /******************************* m_read ************************************/
@@ -153,13 +354,12 @@ int m_write( u_int8 *addr, u_int8  index, u_int16 data )
  ****************************************************************************/
 int m_read( U_INT32_OR_64 base, u_int8 index )
 {
-    register u_int16    wx;                 /* data word    */
-    register int        i;                  /* counter      */
+    u_int16    wx;                          /* data word    */
+    ID_BUS     bus;
 
-    _opcode(base, (u_int8)(_READ_+index) );
-    for(wx=0, i=0; i<16; i++)
-        wx = (u_int16)((wx<<1)+_clock(base,0));
-    _deselect(base);
+    ID_BusOpen( &bus, base, MODREG );
+    _readburst( &bus, index, 1, &wx );
+    ID_BusClose( &bus );
 
     return(wx);
 }
@@ -170,6 +370,11 @@ int m_read( U_INT32_OR_64 base, u_int8 index )
  *                The function reads the magic-id, mod-id, layout-rev and
  *                product-variant from the EEPROM, evaluates these parameters
  *                and provide the module information for the caller.
+ *                Repeated queries of the same base are served from a
+ *                cache without bus access (see m_cacheflush()). The
+ *                module is locked from the cache lookup until the read
+ *                data is stored, so a concurrent write of the module
+ *                cannot leave stale data in the cache.
  *
  *                1) If the four read values are equal, then we assume that
  *                   the EEPROM is not present or is invalid.
@@ -218,19 +423,47 @@ int m_getmodinfo(
 	char    *devname )
 {
 	u_int16	magic, modid, layout, variant;
+	u_int16	word[3];
 	u_int8	addSuffix = FALSE;
 	char	*bufptr = devname;
+	CACHE_ENTRY *entry;
+	ID_BUS	bus;
+	u_int32	lock;
 
 	/* set defaults */
 	*devid   = 0xffffffff;
 	*devrev  = 0xffffffff;
 	*devname = '\0';
 
-	/* read data from eeprom */
-	magic   = (u_int16)m_read(base, 0);
-	modid   = (u_int16)m_read(base, 1);
-	layout  = (u_int16)m_read(base, 2);
-	variant	= (u_int16)m_read(base, 8);
+	lock = _mlock( &base, 1 );
+
+	ID_LockAux( ID_AUX_CACHE );
+	if( (entry = _cachefind(base)) != NULL ){
+		/* cached */
+		G_cacheHits++;
+		magic   = entry->magic;
+		modid   = entry->modid;
+		layout  = entry->layout;
+		variant = entry->variant;
+	}
+	else
+		G_cacheMisses++;
+	ID_UnlockAux( ID_AUX_CACHE );
+
+	if( entry == NULL ){
+		/* read data from eeprom (words 0..2 in one burst) */
+		ID_BusOpenX( &bus, base, MODREG, 16 );	/* module already locked */
+		_readburst(&bus, 0, 3, word);
+		_readburst(&bus, 8, 1, &variant);
+		ID_BusClose( &bus );
+		magic   = word[0];
+		modid   = word[1];
+		layout  = word[2];
+
+		_cachestore( base, magic, modid, layout, variant );
+	}
+
+	ID_Unlock( lock );
 
 	/*------------------------------+
 	| M-Module without id-prom data |
@@ -313,6 +546,281 @@ int m_getmodinfo(
 	return 0;
 }
 
+/******************************* m_cacheflush ******************************/
+/**   Flush the m_getmodinfo() cache.
+ *
+ *    m_getmodinfo() keeps the id-prom data of the last 16 modules.
+ *    Writes through this library invalidate the entry of the written
+ *    module automatically. Call this function when modules are
+ *    exchanged (hot-plug) or the EEPROM was written by other means.
+ *
+ *---------------------------------------------------------------------------
+ *  \param base			\IN base address pointer or ID_CACHE_ALL
+ *
+ ****************************************************************************/
+void m_cacheflush( U_INT32_OR_64 base )
+{
+	u_int32 i;
+
+	ID_LockAux( ID_AUX_CACHE );
+	for( i=0; i<CACHE_SIZE; i++ )
+		if( base == ID_CACHE_ALL || G_cache[i].base == base )
+			G_cache[i].valid = FALSE;
+	ID_UnlockAux( ID_AUX_CACHE );
+}
+
+/******************************* m_cachestat *******************************/
+/**   Get the m_getmodinfo() cache counters.
+ *
+ *---------------------------------------------------------------------------
+ *  \param hitsP		\OUT queries served from the cache
+ *  \param missesP		\OUT queries read from the EEPROM
+ *
+ ****************************************************************************/
+void m_cachestat( u_int32 *hitsP, u_int32 *missesP )
+{
+	ID_LockAux( ID_AUX_CACHE );
+	*hitsP   = G_cacheHits;
+	*missesP = G_cacheMisses;
+	ID_UnlockAux( ID_AUX_CACHE );
+}
+
+/******************************* m_readmulti *******************************/
+/**   Read a range of words from the EEPROMs of several modules in lockstep.
+ *
+ *    The MODREG registers of all modules are independent, so every clock
+ *    phase is driven on all modules within the same delay window and
+ *    the DO lines of all modules are sampled per bit. Reading n modules
+ *    takes about the time of one.
+ *
+ *---------------------------------------------------------------------------
+ *  \param bases		\IN base address pointers of the modules
+ *  \param n			\IN number of modules
+ *  \param index		\IN first index to read (0..63)
+ *  \param count		\IN number of words to read (1..64)
+ *  \param buff			\OUT user buffer (n * count words),
+ *                          words of module i start at buff[i*count]
+ *  \return   0=ok, 1=error
+ *
+ ****************************************************************************/
+int m_readmulti( U_INT32_OR_64 *bases, u_int32 n, u_int8 index,
+                 u_int8 count, u_int16 *buff )
+{
+    u_int32 lock;
+
+    if( n == 0 || count == 0 || (index + count) > ID_MOD_EEPROM_WORDS )
+        return 1;
+
+    lock = _mlock( bases, n );
+    _mreadburst( bases, n, index, count, buff );
+    ID_Unlock( lock );
+    return 0;
+}
+
+/******************************* m_scanmodinfo *****************************/
+/**   Read the id-prom data of several modules in lockstep into the cache.
+ *
+ *    Following m_getmodinfo() calls for these modules are served from
+ *    the cache. Modules are read in groups of 16; as the cache keeps
+ *    16 modules, only the last 16 of a larger scan remain cached.
+ *    The modules of a group stay locked until their data is stored.
+ *
+ *---------------------------------------------------------------------------
+ *  \param bases		\IN base address pointers of the modules
+ *  \param n			\IN number of modules
+ *  \return   0=ok, 1=error
+ *
+ ****************************************************************************/
+int m_scanmodinfo( U_INT32_OR_64 *bases, u_int32 n )
+{
+    u_int16 word[CACHE_SIZE*3];             /* words 0..2 */
+    u_int16 variant[CACHE_SIZE];            /* word 8 */
+    u_int32 i, grp, lock;
+
+    if( n == 0 )
+        return 1;
+
+    for( ; n; n -= grp, bases += grp )
+    {
+        grp = n < CACHE_SIZE ? n : CACHE_SIZE;
+
+        lock = _mlock( bases, grp );
+        _mreadburst( bases, grp, 0, 3, word );
+        _mreadburst( bases, grp, 8, 1, variant );
+
+        for( i=0; i<grp; i++ )
+            _cachestore( bases[i], word[i*3], word[i*3+1], word[i*3+2],
+                         variant[i] );
+        ID_Unlock( lock );
+
+        ID_LockAux( ID_AUX_CACHE );
+        G_cacheMisses += grp;
+        ID_UnlockAux( ID_AUX_CACHE );
+    }
+    return 0;
+}
+
+/******************************* m_writestart ******************************/
+/**   Start a non-blocking write of a word range.
+ *
+ *    Same as m_writerange(), but the function returns as soon as the
+ *    first programming cycle has been started. The job is advanced with
+ *    ID_WriteStep() until it returns ID_AW_DONE or ID_AW_ERROR
+ *    (job->error: 1=write err 2=verify err 3=erase err). The timeout
+ *    of the ready polling is the default of ID_PollConfigSet().
+ *    The module must not be accessed otherwise until the job has
+ *    finished.
+ *
+ *---------------------------------------------------------------------------
+ *  \param job		\OUT write job
+ *  \param addr		\IN base address pointer
+ *  \param index	\IN first index to write (0..63)
+ *  \param count	\IN number of words to write (1..64)
+ *  \param buff		\IN user buffer (count words), must be kept until
+ *                      the job has finished
+ *  \param flags	\IN write flags (ID_WF_xxx)
+ *  \return   0=ok; 4=illegal range
+ *
+ ****************************************************************************/
+int m_writestart( ID_AWRITE *job, u_int8 *addr, u_int8 index, u_int8 count,
+                  u_int16 *buff, u_int32 flags )
+{
+    ID_BUS  bus;
+
+    if( count == 0 || (index + count) > ID_MOD_EEPROM_WORDS )
+        return 4;
+
+    job->step    = _mstep;
+    job->osHdl   = NULL;
+    job->hdl     = NULL;
+    job->base    = (U_INT32_OR_64)addr;
+    job->buff    = buff;
+    job->index   = index;
+    job->count   = count;
+    job->flags   = flags;
+    job->state   = AW_NEXT;
+    job->polls   = 0;
+    job->written = 0;
+    job->pollUs  = 0;
+    job->error   = 0;
+
+    m_cacheflush( job->base );              /* invalidate cache */
+
+    ID_BusOpen( &bus, job->base, MODREG );
+    _opcode(&bus,EWEN);                     /* write enable */
+    _deselect(&bus);                        /* deselect     */
+    _awstep( &bus, job );                   /* start first word */
+    ID_BusClose( &bus );
+
+    return 0;
+}
+
+/******************************* m_writemulti ******************************/
+/**   Write a word range to the EEPROMs of several modules concurrently.
+ *
+ *    A m_writestart() job is started on each module and all jobs are
+ *    run round-robin by ID_WriteRun(): while one module is busy with
+ *    its programming cycle, the next word is started on the others.
+ *    Modules are programmed in groups of 8, so the time for a rack
+ *    approaches that of one module per group.
+ *
+ *---------------------------------------------------------------------------
+ *  \param bases		\IN base address pointers of the modules
+ *  \param n			\IN number of modules
+ *  \param index		\IN first index to write (0..63)
+ *  \param count		\IN number of words to write (1..64)
+ *  \param buff			\IN user buffer (n * count words),
+ *                          words of module i start at buff[i*count]
+ *  \param flags		\IN write flags (ID_WF_xxx)
+ *  \param errors		\OUT error code per module (see m_writerange()),
+ *                          may be NULL
+ *  \return   0=ok, 1=error
+ *
+ ****************************************************************************/
+int m_writemulti( U_INT32_OR_64 *bases, u_int32 n, u_int8 index,
+                  u_int8 count, u_int16 *buff, u_int32 flags, int *errors )
+{
+    ID_AWRITE   job[WRITE_GROUP];
+    u_int32     i, grp;
+    int         rv = 0;
+
+    if( n == 0 || count == 0 || (index + count) > ID_MOD_EEPROM_WORDS )
+        return 1;
+
+    for( ; n; n -= grp, bases += grp, buff += grp * count )
+    {
+        grp = n < WRITE_GROUP ? n : WRITE_GROUP;
+
+        for( i=0; i<grp; i++ )
+            m_writestart( &job[i], (u_int8*)bases[i], index, count,
+                          &buff[i * count], flags );
+
+        if( ID_WriteRun( job, grp ) )
+            rv = 1;
+
+        if( errors ){
+            for( i=0; i<grp; i++ )
+                *errors++ = job[i].error;
+        }
+    }
+    return rv;
+}
+
+/******************************* _cachestore *******************************/
+/**   Store the id-prom data of a module in the cache.
+ *
+ *---------------------------------------------------------------------------
+ *  \param base			\IN base address pointer
+ *  \param magic		\IN word 0
+ *  \param modid		\IN word 1
+ *  \param layout		\IN word 2
+ *  \param variant		\IN word 8
+ ****************************************************************************/
+static void _cachestore( U_INT32_OR_64 base, u_int16 magic, u_int16 modid,
+                         u_int16 layout, u_int16 variant )
+{
+	CACHE_ENTRY *entry;
+	u_int32 i;
+
+	ID_LockAux( ID_AUX_CACHE );
+
+	for( i=0; i<CACHE_SIZE; i++ )			/* drop old entry of module */
+		if( G_cache[i].base == base )
+			G_cache[i].valid = FALSE;
+
+	entry = &G_cache[G_cacheNext];
+	G_cacheNext = (G_cacheNext + 1) % CACHE_SIZE;
+	entry->valid   = FALSE;
+	entry->base    = base;
+	entry->magic   = magic;
+	entry->modid   = modid;
+	entry->layout  = layout;
+	entry->variant = variant;
+	entry->valid   = TRUE;					/* publish last */
+
+	ID_UnlockAux( ID_AUX_CACHE );
+}
+
+/******************************* _cachefind ********************************/
+/**   Find the cache entry of a module.
+ *
+ *    The caller holds ID_AUX_CACHE.
+ *
+ *---------------------------------------------------------------------------
+ *  \param base			\IN base address pointer
+ *  \return   entry or NULL
+ ****************************************************************************/
+static CACHE_ENTRY *_cachefind( U_INT32_OR_64 base )
+{
+	u_int32 i;
+
+	for( i=0; i<CACHE_SIZE; i++ )
+		if( G_cache[i].valid && G_cache[i].base == base )
+			return &G_cache[i];
+
+	return NULL;
+}
+
 /******************************* _xtoa *************************************/
 /**   Converts an u_int32 to a character string.
  *
@@ -359,193 +867,472 @@ static void _xtoa( u_int32 val, u_int32 radix, char *buf )
     } while (firstdig < p); /* repeat until halfway */
 }
 
-/******************************* _write ***********************************/
-/**   Write a specified word into EEPROM at 'base'.
+/******************************* _writesession ****************************/
+/**   Write <count> words starting at <index> in one write session.
+ *
+ *    EWEN is sent once before the first word and EWDS once after the
+ *    last word, also on every error path. Each word is erased (unless
+ *    ID_WF_NOERASE), written and verified; the ready state is polled
+ *    after each programming cycle.
+ *
+ *    With ID_WF_DIFF the current contents is burst read first. Words
+ *    that already hold the data are skipped, erased words are not
+ *    erased again. If nothing differs, no session is opened at all.
  *
  *---------------------------------------------------------------------------
- *	\param base			\IN base address pointer
- *	\param index		\IN index to write (0..63)
- *  \param data			\IN word to write
- *  \return   0=ok 1=write err 2=verify err
+ *	\param bus			\IN bus access context
+ *	\param index		\IN first index to write (0..63)
+ *	\param count		\IN number of words to write
+ *	\param buff			\IN words to write
+ *	\param flags		\IN write flags (ID_WF_xxx)
+ *	\param writtenP		\OUT number of words programmed (may be NULL)
+ *  \return   0=ok 1=write err 2=verify err 3=erase err
  *
  ***************************************************************************/
-static int _write( U_INT32_OR_64 base, u_int8 index, u_int16 data )
+static int _writesession( ID_BUS *bus, u_int8 index, u_int8 count,
+                          u_int16 *buff, u_int32 flags, u_int32 *writtenP )
 {
-    register int    i,j;                    /* counters     */
+    u_int16         cur[ID_MOD_EEPROM_WORDS];   /* current contents */
+    u_int16         rd;                     /* read back    */
+    register u_int16 data;                  /* data word    */
+    register u_int8 n;                      /* counter      */
+    int             erase;                  /* erase word first */
+    u_int32         written = 0;
+    int             error = 0;
+
+    m_cacheflush( bus->base );              /* invalidate cache */
+
+    if( flags & ID_WF_DIFF )
+    {
+        _readburst( bus, index, count, cur );
+        for( n=0; n<count && cur[n] == buff[n]; n++ )
+            ;
+        if( n == count )                    /* nothing to do */
+            goto DONE;
+    }
+
+    _opcode(bus,EWEN);                      /* write enable */
+    _deselect(bus);                         /* deselect     */
 
-    _opcode(base,EWEN);                     /* write enable */
-    _deselect(base);                        /* deselect     */
+    for( n=0; n<count; n++, index++ )
+    {
+        data  = buff[n];
+        erase = !(flags & ID_WF_NOERASE);
 
-    _opcode(base, (u_int8)(_WRITE_+index) );             /* select write */
-    for(i=15; i>=0; i--)
-        _clock(base,(u_int8)((data>>i)&0x01));        /* write data   */
-    _deselect(base);                        /* deselect     */
+        if( flags & ID_WF_DIFF )
+        {
+            if( cur[n] == data )            /* already there */
+                continue;
+            if( cur[n] == ID_ERASED_WORD )  /* already erased */
+                erase = FALSE;
+        }
 
-    _select(base);
-    for(i=T_WP; i>0; i--)                   /* wait for low */
-    {   if(!_clock(base,0))
+        if( erase && _erasecell(bus,index) ){
+            error = 3;
             break;
-        _delay();
-    }
-    for(j=T_WP; j>0; j--)                   /* wait for high*/
-    {   if(_clock(base,0))
+        }
+
+        if( _writecell(bus,(u_int8)(_WRITE_+index),data) ){
+            error = 1;
+            break;
+        }
+        written++;
+
+        _readburst( bus, index, 1, &rd );   /* verify data  */
+        if( data != rd ){
+            error = 2;
             break;
-        _delay();
+        }
     }
 
-    _opcode(base, EWDS);                    /* write disable*/
-    _deselect(base);                        /* disable      */
+    _opcode(bus, EWDS);                     /* write disable*/
+    _deselect(bus);                         /* disable      */
 
-    if((i==0) || (j==0))                    /* error ?      */
-        return 1;                           /* ..yes */
+DONE:
+    m_cacheflush( bus->base );              /* invalidate cache */
 
-    if( data != m_read(base,index) )        /* verify data  */
-        return 2;                           /* ..error      */
+    if( writtenP )
+        *writtenP = written;
 
-    return 0;                               /* ..no         */
+    return error;
 }
 
-/******************************* _erase ***********************************/
-/**   Erase a specified word into EEPROM
+/******************************* _writeall ********************************/
+/**   Program the whole EEPROM with ERAL/WRAL.
+ *
+ *    The device is erased with one ERAL cycle. If a fill value other
+ *    than 0xFFFF saves cycles (see ID_FillValue()), it is written with
+ *    one WRAL cycle. Afterwards only the words that differ from the fill value
+ *    are programmed and the whole device is verified with a burst read.
  *
  *---------------------------------------------------------------------------
- *	\param base			\IN base address pointer
- *	\param index		\IN index to write (0..15)
- *  \return   0=ok 1=error
+ *	\param bus			\IN bus access context
+ *	\param buff			\IN image (64 words)
+ *	\param flags		\IN write flags (ID_WF_xxx)
+ *  \return   0=ok 1=write err 2=verify err 3=erase err
  *
  ***************************************************************************/
-static int _erase( U_INT32_OR_64 base, u_int8 index )
+static int _writeall( ID_BUS *bus, u_int16 *buff, u_int32 flags )
 {
-    register int    i,j;                    /* counters     */
+    u_int16         rd[ID_MOD_EEPROM_WORDS];
+    u_int16         fill;
+    u_int8          index;
+    int             error = 0;
 
-    _opcode(base,EWEN);                     /* erase enable */
-    for(i=0;i<4;i++) _clock(base,0);
-    _deselect(base);                        /* deselect     */
+    fill = ID_FillValue( buff, ID_MOD_EEPROM_WORDS, flags );
 
-    _opcode(base,(u_int8)(ERASE+index) );              /* select erase */
-    _deselect(base);                        /* deselect     */
+    m_cacheflush( bus->base );              /* invalidate cache */
 
-    _select(base);
-    for(i=T_WP; i>0; i--)                   /* wait for low */
-    {   if(!_clock(base,0))
-            break;
-        _delay();
+    _opcode(bus,EWEN);                      /* write enable */
+    _deselect(bus);                         /* deselect     */
+
+    _opcode(bus,ERAL);                      /* chip erase   */
+    _deselect(bus);
+    if( _waitready(bus) ){
+        error = 3;
+        goto DISABLE;
     }
 
-    for(j=T_WP; j>0; j--)                   /* wait for high*/
-    {   if(_clock(base,0))
-            break;
-        _delay();
+    if( fill != ID_ERASED_WORD &&           /* chip write   */
+        _writecell(bus,WRAL,fill) ){
+        error = 1;
+        goto DISABLE;
     }
 
-    _opcode(base,EWDS);                     /* erase disable*/
-    _deselect(base);                        /* disable      */
+    for( index=0; index<ID_MOD_EEPROM_WORDS; index++ )
+    {
+        if( buff[index] == fill )
+            continue;
+
+        if( fill != ID_ERASED_WORD && !(flags & ID_WF_NOERASE) &&
+            _erasecell(bus,index) ){
+            error = 3;
+            goto DISABLE;
+        }
+
+        if( _writecell(bus,(u_int8)(_WRITE_+index),buff[index]) ){
+            error = 1;
+            goto DISABLE;
+        }
+    }
+
+DISABLE:
+    _opcode(bus, EWDS);                     /* write disable*/
+    _deselect(bus);                         /* disable      */
+
+    m_cacheflush( bus->base );              /* invalidate cache */
+
+    if( error )
+        return error;
+
+    _readburst( bus, 0, ID_MOD_EEPROM_WORDS, rd );   /* verify data */
+    for( index=0; index<ID_MOD_EEPROM_WORDS; index++ )
+        if( rd[index] != buff[index] )
+            return 2;
 
-    if((i==0) || (j==0))                    /* error ?      */
-        return 1;
     return 0;
 }
 
-/******************************* _opcode ***********************************/
-/**   Output opcode with leading startbit
+/******************************* _mstep ************************************/
+/**   ID_WriteStep() of m_writestart() jobs
  *
  *---------------------------------------------------------------------------
- *	\param base			\IN base address pointer
- *	\param code			\IN opcode to write
+ *	\param job			\INOUT write job
+ *  \return   ID_AW_xxx
  *
  ***************************************************************************/
-static void _opcode( U_INT32_OR_64 base, u_int8 code )
+static int _mstep( ID_AWRITE *job )
 {
-    register int i;
-
-    _select(base);
-    _clock(base,1);                         /* output start bit */
+    ID_BUS  bus;
+    int     rv;
 
-    for(i=7; i>=0; i--)
-        _clock(base,(u_int8)((code>>i)&0x01) );        /* output instruction code  */
-}
+    if( job->state == AW_DONE )
+        return job->error ? ID_AW_ERROR : ID_AW_DONE;
 
+    ID_BusOpen( &bus, job->base, MODREG );
+    rv = _awstep( &bus, job );
+    ID_BusClose( &bus );
 
-/*----------------------------------------------------------------------
- * LOW-LEVEL ROUTINES FOR SERIAL EEPROM
- *--------------------------------------------------------------------*/
+    return rv;
+}
 
-/******************************* _select ***********************************/
-/**   Select EEPROM:
- *                 output DI/CLK/CS low
- *                 delay
- *                 output CS high
- *                 delay
+/******************************* _awstep ***********************************/
+/**   Non-blocking write state machine.
+ *
+ *    While a programming cycle runs, each step selects the EEPROM and
+ *    samples DO once: other transactions on the module may have run
+ *    between two steps, so CS is asserted again each time. The cycle
+ *    has finished when DO is high, even if no busy state was seen (a
+ *    caller stepping slower than the programming time never sees it).
+ *    Then the word is verified and the next ERASE or WRITE is shifted
+ *    out. EWDS is sent at the end and on every error.
+ *
  *---------------------------------------------------------------------------
- *  \param base			\IN base address pointer
+ *	\param bus			\IN bus access context
+ *	\param job			\INOUT write job
+ *  \return   ID_AW_xxx
  *
  ***************************************************************************/
-static void _select( U_INT32_OR_64 base )
+static int _awstep( ID_BUS *bus, ID_AWRITE *job )
 {
-    MWRITE_D16( base, MODREG, 0 );			/* everything inactive */
-    _delay();
-    MWRITE_D16( base, MODREG, B_SEL );		/* select high */
-    _delay();
+    u_int16         rd;
+    int             erase;
+
+    for(;;)
+    {
+        switch( job->state )
+        {
+        case AW_NEXT:
+            if( job->count == 0 ){
+                _opcode(bus, EWDS);         /* write disable*/
+                _deselect(bus);
+                m_cacheflush( job->base );
+                job->state = AW_DONE;
+                return ID_AW_DONE;
+            }
+
+            erase = !(job->flags & ID_WF_NOERASE);
+            if( job->flags & ID_WF_DIFF ){
+                _readburst( bus, (u_int8)job->index, 1, &rd );
+                if( rd == *job->buff ){     /* already there */
+                    job->index++;
+                    job->buff++;
+                    job->count--;
+                    continue;
+                }
+                if( rd == ID_ERASED_WORD )  /* already erased */
+                    erase = FALSE;
+            }
+
+            if( erase ){
+                _opcode(bus,(u_int8)(ERASE+job->index) );
+                _deselect(bus);
+                job->state = AW_ERASING;
+            }
+            else {
+                _writeop(bus,(u_int8)(_WRITE_+job->index),*job->buff);
+                job->state = AW_WRITING;
+            }
+            ID_PollStart( job, NULL );
+            return ID_AW_BUSY;
+
+        case AW_ERASING:
+        case AW_WRITING:
+            _select(bus,0);                 /* DO = ready/busy */
+            if( ID_MW_IN( bus ) ){
+                _deselect(bus);
+                if( job->state == AW_ERASING ){ /* erased: write */
+                    _writeop(bus,(u_int8)(_WRITE_+job->index),*job->buff);
+                    job->state = AW_WRITING;
+                    ID_PollStart( job, NULL );
+                    return ID_AW_BUSY;
+                }
+
+                job->written++;
+                _readburst( bus, (u_int8)job->index, 1, &rd );
+                if( rd != *job->buff )      /* verify data  */
+                    return _awerror( bus, job, 2 );
+
+                job->index++;
+                job->buff++;
+                job->count--;
+                job->state = AW_NEXT;
+                continue;
+            }
+
+            _deselect(bus);
+            if( ID_PollExpired( job ) )
+                return _awerror( bus, job,
+                                 job->state == AW_ERASING ? 3 : 1 );
+            return ID_AW_BUSY;
+
+        default:
+            return job->error ? ID_AW_ERROR : ID_AW_DONE;
+        }
+    }
 }
 
-/******************************* _deselect *********************************/
-/**   Deselect EEPROM
- *                 output CS low
+/******************************* _awerror **********************************/
+/**   Abort non-blocking write: write disable, set error
+ *
  *---------------------------------------------------------------------------
- *  \param base			\IN base address pointer
+ *	\param bus			\IN bus access context
+ *	\param job			\INOUT write job
+ *	\param error		\IN error code (see m_writerange())
+ *  \return   ID_AW_ERROR
  *
  ***************************************************************************/
-static void _deselect( U_INT32_OR_64 base )
+static int _awerror( ID_BUS *bus, ID_AWRITE *job, int error )
 {
-    MWRITE_D16( base, MODREG, 0 );			/* everything inactive */
-}
+    _opcode(bus, EWDS);                     /* write disable*/
+    _deselect(bus);
+    m_cacheflush( job->base );
 
+    job->error = error;
+    job->state = AW_DONE;
+    return ID_AW_ERROR;
+}
 
-/******************************* _clock ***********************************/
-/**   Output data bit:
- *                 output clock low
- *                 output data bit
- *                 delay
- *                 output clock high
- *                 delay
- *                 return state of data serial eeprom's DO - line
- *                 (Note: keep CS asserted)
+/******************************* _erasecell *******************************/
+/**   Erase one word and wait for ready (erase/write must be enabled)
+ *
  *---------------------------------------------------------------------------
- *  \param base			\IN base address pointer
- *	\param dbs			\IN	data bit to send
- *  \return state of DO line
+ *	\param bus			\IN bus access context
+ *	\param index		\IN index to erase (0..63)
+ *  \return   0=ok 1=timeout
  *
  ***************************************************************************/
-static int _clock( U_INT32_OR_64 base, u_int8 dbs )
+static int _erasecell( ID_BUS *bus, u_int8 index )
 {
-    MWRITE_D16( base, MODREG, dbs|B_SEL );  /* output clock low */
-                                            /* output data high/low */
-    _delay();                               /* delay    */
+    _opcode(bus,(u_int8)(ERASE+index) );    /* select erase */
+    _deselect(bus);                         /* deselect     */
 
-    MWRITE_D16( base, MODREG, dbs|B_CLK|B_SEL );  /* output clock high */
-    _delay();                               /* delay    */
-
-    return( MREAD_D16( base, MODREG) & B_DAT );  /* get data */
+    return _waitready(bus);                 /* wait for ready */
 }
 
-/******************************* _delay ************************************/
-/**   Delay (at least) one microsecond
+/******************************* _writecell *******************************/
+/**   Send WRITE or WRAL with data and wait for ready
+ *    (erase/write must be enabled)
+ *
  *---------------------------------------------------------------------------
+ *	\param bus			\IN bus access context
+ *	\param code			\IN opcode (_WRITE_+index or WRAL)
+ *	\param data			\IN word to write
+ *  \return   0=ok 1=timeout
  *
  ***************************************************************************/
-static void _delay( void )
+static int _writecell( ID_BUS *bus, u_int8 code, u_int16 data )
 {
-    register volatile int i,n;
+    _writeop(bus, code, data);              /* start programming */
 
-    for(i=DELAY; i>0; i--)
-        n=10*10;
+    return _waitready(bus);                 /* wait for ready */
 }
 
+/******************************* _waitready ********************************/
+/**   Wait until the programming cycle has finished.
+ *
+ *    Same as a step of _awstep(): the EEPROM is selected again and DO
+ *    is sampled once without clocking (low=busy, high=ready), no busy
+ *    sample is required. Between two samples the EEPROM is deselected
+ *    and the back-off of the polling configuration is waited. The
+ *    timeout is based on elapsed time (see ID_WaitNext()).
+ *
+ *---------------------------------------------------------------------------
+ *	\param bus			\IN bus access context
+ *  \return   0=ok 1=timeout
+ *
+ ***************************************************************************/
+static int _waitready( ID_BUS *bus )
+{
+    ID_WAIT  wait;
+    int      error = 1;
 
+    ID_WaitStart( NULL, NULL, &wait );
 
+    for(;;)
+    {
+        _select(bus,0);                         /* DO = ready/busy */
+        if( ID_MW_IN( bus ) ){
+            error = 0;
+            break;
+        }
+        _deselect(bus);
+        if( ID_WaitNext( &wait ) )
+            break;
+    }
+    _deselect(bus);
 
+    return error;
+}
 
+/******************************* _mlock ************************************/
+/**   Lock the registers of <n> modules (see ID_Lock())
+ *
+ *    The bit timing is calibrated before, if not yet done.
+ *---------------------------------------------------------------------------
+ *	\param bases		\IN base address pointers
+ *	\param n			\IN number of modules
+ *  \return   lock mask, release with ID_Unlock()
+ *
+ ***************************************************************************/
+static u_int32 _mlock( U_INT32_OR_64 *bases, u_int32 n )
+{
+    u_int32 s, lock = 0;
 
+    ID_TimeCheck( NULL );                   /* calibrate before locking */
+    for( s=0; s<n; s++ )
+        lock |= ID_LockMask( bases[s] + MODREG );
+    ID_Lock( lock );
 
+    return lock;
+}
 
+/******************************* _mreadburst *******************************/
+/**   Sequential read of <count> words on <n> modules in lockstep
+ *
+ *    Each module is driven through its own bus context, up to
+ *    READ_GROUP modules form one group: the frame is emitted on all
+ *    of them by _opcode()/_clockout() and the DO lines of all are
+ *    sampled per bit. The caller holds the locks of the modules
+ *    (see _mlock()).
+ *
+ *---------------------------------------------------------------------------
+ *	\param bases		\IN base address pointers
+ *	\param n			\IN number of modules
+ *	\param index		\IN first index to read (0..63)
+ *	\param count		\IN number of words to read
+ *	\param buff			\OUT user buffer (n * count words)
+ *
+ ***************************************************************************/
+static void _mreadburst( U_INT32_OR_64 *bases, u_int32 n, u_int8 index,
+                         u_int8 count, u_int16 *buff )
+{
+    ID_BUS              bus[READ_GROUP];    /* bus of each module */
+    register u_int32    s;                  /* module       */
+    register int        i;                  /* counter      */
+    u_int32             grp;                /* modules of group */
+    u_int8              w;                  /* word         */
+
+    for( ; n; n -= grp, bases += grp, buff += grp * count )
+    {
+        grp = n < READ_GROUP ? n : READ_GROUP;
+
+        for( s=0; s<grp; s++ )              /* modules already locked */
+            ID_BusOpenX( &bus[s], bases[s], MODREG, 16 );
+        bus[0].slots = grp;                 /* drive the whole group */
+
+        _opcode( bus, ID_MW_READ(bus,index) );
+
+        for( w=0; w<count; w++ )
+        {
+            for( s=0; s<grp; s++ )
+                buff[s*count+w] = 0;
+
+            for( i=0; i<16; i++ )
+            {
+                _clockout( bus, 0 );
+                for( s=0; s<grp; s++ )      /* sample all DO lines */
+                    buff[s*count+w] = (u_int16)((buff[s*count+w]<<1) +
+                        (ID_BUS_READ_D16( &bus[s], MODREG ) & B_DAT));
+            }
+        }
+        _deselect( bus );                   /* everything inactive */
+
+        for( s=0; s<grp; s++ )
+            ID_BusClose( &bus[s] );
+    }
+}
+
+/*----------------------------------------------------------------------
+ * LOW-LEVEL ROUTINES FOR SERIAL EEPROM
+ *--------------------------------------------------------------------*/
 
+/******************************* _delay ************************************/
+/**   Delay one half clock period (calibrated, see id_time.c)
+ *---------------------------------------------------------------------------
+ *
+ ***************************************************************************/
+static void _delay( void )
+{
+    ID_DelayNs( ID_T_MW_HALF_NS );
+}
@@ -0,0 +1,473 @@
+/*********************  P r o g r a m  -  M o d u l e **********************/
+/*!
+ *         \file id_bench.c
+ *      Project: ID LIB
+ *
+ *       \author kp
+ *
+ *        \brief Benchmark of the ID library read/write entry points
+ *
+ *               Runs every public read/write function against the
+ *               simulated EEPROMs of the id_sim library variant and
+ *               prints one CSV line per operation and bus clock:
+ *
+ *               op,clock_khz,reads,writes,delays,delay_ns,sleep_ns,
+ *               polls,timing_errs,sim_ns,wall_ns
+ *
+ *               All values are per call. clock_khz 0 is the fixed
+ *               library timing of the m_xxx/usm_xxx functions, polls
+ *               are register reads while the EEPROM was busy, sim_ns is
+ *               the virtual time and wall_ns the host CPU time.
+ *
+ *               With -r=<file> the results are compared against a
+ *               reference output (e.g. id_bench.ref). If any operation
+ *               needs more register accesses, delays or virtual time
+ *               than the reference, or fails, the program exits with 1.
+ *
+ *     Required: id_sim library
+ *     Switches: ID_SIM
+ */
+/*
+ *---------------------------------------------------------------------------
+ * Copyright 1999-2019, MEN Mikro Elektronik GmbH
+ ******************************************************************************/
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <MEN/men_typs.h>
+#include <MEN/oss.h>
+#include <MEN/modcom.h>
+#include <MEN/microwire.h>
+#include "id_ext.h"
+#include "id_sim.h"
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define MOD_BASE		0x10000		/* simulated M-Module */
+#define USM_BASE		0x20000		/* simulated USM */
+#define MODREG			0xfe		/* ID register */
+
+#define ACCESS_NS		200			/* simulated register access time */
+#define ITER_DEF		10			/* default iterations */
+#define REF_MAX			64			/* max. reference lines */
+
+/*--------------------------------------+
+|   TYPDEFS                             |
++--------------------------------------*/
+/** result of one operation */
+typedef struct
+{
+	char		op[32];
+	u_int32		clock;
+	u_int32		reads, writes, delays, polls, timingErrs;
+	u_int64		delayNs, sleepNs, simNs, wallNs;
+	int			error;
+} RESULT;
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static u_int16	G_img[ID_MOD_EEPROM_WORDS];		/* M-Module image */
+static u_int16	G_usmImg[USM_EEPROM_WORDS];		/* USM image */
+static u_int16	G_buf[USM_EEPROM_WORDS];
+static void		*G_mcrwHdl;
+static u_int32	G_iter = ITER_DEF;
+static RESULT	G_ref[REF_MAX];
+static int		G_nRef;
+static int		G_failed;
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage( void );
+static int  readref( const char *file );
+static void report( RESULT *res );
+static u_int64 wallns( void );
+static void setup( void );
+static void run( const char *op, u_int32 clock, int (*fn)( u_int32 i ) );
+static int  mcrwopen( u_int8 clock );
+
+static int op_m_read( u_int32 i );
+static int op_m_mread( u_int32 i );
+static int op_m_write( u_int32 i );
+static int op_m_getmodinfo( u_int32 i );
+static int op_usm_read( u_int32 i );
+static int op_usm_mread( u_int32 i );
+static int op_usm_write( u_int32 i );
+static int op_usm_mwrite( u_int32 i );
+static int op_mcrwReadEeprom( u_int32 i );
+static int op_mcrwWriteEeprom( u_int32 i );
+
+/********************************* usage ************************************/
+/**  Print program usage
+ */
+static void usage( void )
+{
+	printf("Usage: id_bench [<opts>]\n");
+	printf("Function: benchmark ID library on simulated EEPROMs\n");
+	printf("Options:\n");
+	printf("  -n=<iter>  iterations per operation ............ [%d]\n",
+		   ITER_DEF);
+	printf("  -r=<file>  compare with reference, exit 1 on regression\n");
+	printf("\n");
+}
+
+/********************************* main *************************************/
+/** Program main function
+ *
+ *  \param argc       \IN  argument counter
+ *  \param argv       \IN  argument vector
+ *
+ *  \return	          success (0) or error (1)
+ */
+int main( int argc, char *argv[] )
+{
+	/* clocks the descriptor can hold (MCRW_DESC_PORT.busClock is u_int8) */
+	static const u_int8 clocks[] = { 50, 100, 250 };
+	u_int32	c;
+	int		i;
+
+	for( i=1; i<argc; i++ ){
+		if( !strncmp( argv[i], "-n=", 3 ) && atoi( argv[i]+3 ) > 0 )
+			G_iter = (u_int32)atoi( argv[i]+3 );
+		else if( !strncmp( argv[i], "-r=", 3 ) ){
+			if( readref( argv[i]+3 ) )
+				return 1;
+		}
+		else {
+			usage();
+			return 1;
+		}
+	}
+
+	setup();
+
+	printf("op,clock_khz,reads,writes,delays,delay_ns,sleep_ns,"
+		   "polls,timing_errs,sim_ns,wall_ns\n");
+
+	run( "m_read",			0, op_m_read );
+	run( "m_mread",			0, op_m_mread );
+	run( "m_write",			0, op_m_write );
+	run( "m_getmodinfo",	0, op_m_getmodinfo );
+	run( "usm_read",		0, op_usm_read );
+	run( "usm_mread",		0, op_usm_mread );
+	run( "usm_write",		0, op_usm_write );
+	run( "usm_mwrite",		0, op_usm_mwrite );
+
+	for( c=0; c<sizeof(clocks)/sizeof(clocks[0]); c++ ){
+		if( mcrwopen( clocks[c] ) ){
+			fprintf( stderr, "*** MCRW_PORT_Init failed\n" );
+			return 1;
+		}
+		run( "mcrwReadEeprom",	clocks[c], op_mcrwReadEeprom );
+		run( "mcrwWriteEeprom",	clocks[c], op_mcrwWriteEeprom );
+		((MCRW_ENTRIES*)G_mcrwHdl)->Exit( &G_mcrwHdl );
+	}
+
+	return G_failed ? 1 : 0;
+}
+
+/********************************* setup ************************************/
+/** Attach the simulated EEPROMs and load the images
+ */
+static void setup( void )
+{
+	u_int32 i;
+
+	for( i=0; i<ID_MOD_EEPROM_WORDS; i++ )
+		G_img[i] = (u_int16)(0x1234 * i + 0x5a5a);
+	G_img[0] = 0x5346;						/* M-Module magic */
+	G_img[1] = 0x00c0;						/* module id */
+	G_img[2] = 0x0001;						/* revision */
+
+	for( i=0; i<USM_EEPROM_WORDS; i++ )
+		G_usmImg[i] = (u_int16)(0x0101 * i + 0x0042);
+	G_usmImg[0] = 0x5553;					/* USM magic */
+
+	ID_SimInit( ACCESS_NS );
+	ID_SimLoad( ID_SimAttachModule( MOD_BASE ), G_img, ID_MOD_EEPROM_WORDS );
+	ID_SimLoad( ID_SimAttachUsm( USM_BASE ), G_usmImg, USM_EEPROM_WORDS );
+}
+
+/********************************* mcrwopen *********************************/
+/** Open Microwire port handle on the simulated M-Module
+ *
+ *  \param clock      \IN  bus clock [kHz]
+ *  \return	          0=ok
+ */
+static int mcrwopen( u_int8 clock )
+{
+	MCRW_DESC_PORT desc;
+	void *reg = (void*)(MOD_BASE + MODREG);
+
+	memset( &desc, 0, sizeof(desc) );
+	desc.busClock		= clock;
+	desc.addrLength		= 6;
+	desc.addrDataIn		= reg;
+	desc.addrDataOut	= reg;
+	desc.addrClockOut	= reg;
+	desc.addrCsOut		= reg;
+	desc.flagsDataIn	= MCRW_DESC_PORT_FLAG_SIZE_16
+						| MCRW_DESC_PORT_FLAG_READABLE_REG
+						| MCRW_DESC_PORT_FLAG_POLARITY_HIGH;
+	desc.flagsDataOut	= MCRW_DESC_PORT_FLAG_SIZE_16
+						| MCRW_DESC_PORT_FLAG_POLARITY_HIGH;
+	desc.flagsClockOut	= desc.flagsDataOut;
+	desc.flagsCsOut		= desc.flagsDataOut;
+	desc.flagsOut		= MCRW_DESC_PORT_FLAG_OUT_IN_ONE_REG;
+	desc.maskDataIn		= 0x01;
+	desc.maskDataOut	= 0x01;
+	desc.maskClockOut	= 0x02;
+	desc.maskCsOut		= 0x04;
+
+	return MCRW_PORT_Init( &desc, NULL, &G_mcrwHdl ) ? 1 : 0;
+}
+
+/********************************* run **************************************/
+/** Run one operation <G_iter> times and report the average
+ *
+ *  Programming cycles of the previous call are finished before each
+ *  call (not counted).
+ *
+ *  \param op         \IN  operation name
+ *  \param clock      \IN  bus clock [kHz] or 0
+ *  \param fn         \IN  operation
+ */
+static void run( const char *op, u_int32 clock, int (*fn)( u_int32 i ) )
+{
+	RESULT		res;
+	ID_SIM_STAT	st;
+	u_int64		simNs = 0, wallNs = 0, t0, s0;
+	u_int32		i;
+
+	memset( &res, 0, sizeof(res) );
+	strncpy( res.op, op, sizeof(res.op)-1 );
+	res.clock = clock;
+
+	ID_SimIdle();
+	ID_SimStatReset();
+
+	for( i=0; i<G_iter; i++ ){
+		ID_SimIdle();
+		ID_SimStatGet( &st );
+		s0 = st.nowNs;
+		t0 = wallns();
+
+		if( fn( i ) )
+			res.error = 1;
+
+		wallNs += wallns() - t0;
+		ID_SimStatGet( &st );
+		simNs += st.nowNs - s0;
+	}
+
+	ID_SimStatGet( &st );
+	res.reads		= st.reads / G_iter;
+	res.writes		= st.writes / G_iter;
+	res.delays		= st.delays / G_iter;
+	res.delayNs		= st.delayNs / G_iter;
+	res.sleepNs		= st.sleepNs / G_iter;
+	res.polls		= st.busyReads / G_iter;
+	res.timingErrs	= st.timingErrs / G_iter;
+	res.simNs		= simNs / G_iter;
+	res.wallNs		= wallNs / G_iter;
+
+	report( &res );
+}
+
+/********************************* report ***********************************/
+/** Print result, compare with reference
+ *
+ *  \param res        \IN  result
+ */
+static void report( RESULT *res )
+{
+	RESULT	*ref;
+	int		i;
+
+	printf("%s,%u,%u,%u,%u,%llu,%llu,%u,%u,%llu,%llu\n",
+		   res->op, res->clock, res->reads, res->writes, res->delays,
+		   (unsigned long long)res->delayNs, (unsigned long long)res->sleepNs,
+		   res->polls, res->timingErrs,
+		   (unsigned long long)res->simNs, (unsigned long long)res->wallNs );
+
+	if( res->error ){
+		fprintf( stderr, "*** %s,%u: operation failed\n", res->op, res->clock );
+		G_failed = 1;
+	}
+
+	for( i=0; i<G_nRef; i++ ){
+		ref = &G_ref[i];
+		if( strcmp( ref->op, res->op ) || ref->clock != res->clock )
+			continue;
+
+		if( res->reads > ref->reads || res->writes > ref->writes
+			|| res->delays > ref->delays || res->simNs > ref->simNs
+			|| res->timingErrs > ref->timingErrs ){
+			fprintf( stderr, "*** %s,%u: regression (reads %u/%u writes %u/%u "
+					 "delays %u/%u timing_errs %u/%u sim_ns %llu/%llu)\n",
+					 res->op, res->clock, res->reads, ref->reads,
+					 res->writes, ref->writes, res->delays, ref->delays,
+					 res->timingErrs, ref->timingErrs,
+					 (unsigned long long)res->simNs,
+					 (unsigned long long)ref->simNs );
+			G_failed = 1;
+		}
+	}
+}
+
+/********************************* readref **********************************/
+/** Read reference output
+ *
+ *  \param file       \IN  file name
+ *  \return	          0=ok
+ */
+static int readref( const char *file )
+{
+	FILE	*fp = fopen( file, "r" );
+	char	line[256], *p;
+	RESULT	*ref;
+	unsigned long long delayNs, sleepNs, simNs, wallNs;
+
+	if( fp == NULL ){
+		fprintf( stderr, "*** can't open %s\n", file );
+		return 1;
+	}
+
+	while( G_nRef < REF_MAX && fgets( line, sizeof(line), fp ) ){
+		ref = &G_ref[G_nRef];
+		if( (p = strchr( line, ',' )) == NULL
+			|| (size_t)(p - line) >= sizeof(ref->op) )
+			continue;
+		memset( ref, 0, sizeof(*ref) );
+		memcpy( ref->op, line, (size_t)(p - line) );
+		if( sscanf( p+1, "%u,%u,%u,%u,%llu,%llu,%u,%u,%llu,%llu",
+					&ref->clock, &ref->reads, &ref->writes, &ref->delays,
+					&delayNs, &sleepNs, &ref->polls, &ref->timingErrs,
+					&simNs, &wallNs ) != 10 )
+			continue;						/* header */
+		ref->simNs = simNs;
+		G_nRef++;
+	}
+
+	fclose( fp );
+	return 0;
+}
+
+/********************************* wallns ***********************************/
+/** Host CPU time [ns]
+ */
+static u_int64 wallns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (u_int64)ts.tv_sec * 1000000000 + (u_int64)ts.tv_nsec;
+}
+
+/*----------------------------------------------------------------------
+ * OPERATIONS (return 0=ok)
+ *--------------------------------------------------------------------*/
+
+static int op_m_read( u_int32 i )
+{
+	u_int8 index = (u_int8)(i % ID_MOD_EEPROM_WORDS);
+
+	return m_read( MOD_BASE, index ) != G_img[index];
+}
+
+static int op_m_mread( u_int32 i )
+{
+	(void)i;
+	m_mread( (u_int8*)MOD_BASE, G_buf );
+	return memcmp( G_buf, G_img, 16 * sizeof(u_int16) ) != 0;
+}
+
+static int op_m_write( u_int32 i )
+{
+	u_int8 index = (u_int8)(16 + i % 16);
+
+	G_img[index] = (u_int16)~G_img[index];
+	return m_write( (u_int8*)MOD_BASE, index, G_img[index] ) != 0;
+}
+
+static int op_m_getmodinfo( u_int32 i )
+{
+	u_int32 modtype, devid, devrev;
+	char	devname[16];
+
+	(void)i;
+	m_cacheflush( ID_CACHE_ALL );			/* measure bus, not cache */
+	return m_getmodinfo( MOD_BASE, &modtype, &devid, &devrev, devname ) != 0;
+}
+
+static int op_usm_read( u_int32 i )
+{
+	u_int8 index = (u_int8)(i % USM_EEPROM_WORDS);
+
+	return usm_read( USM_BASE, index ) != G_usmImg[index];
+}
+
+static int op_usm_mread( u_int32 i )
+{
+	(void)i;
+	return usm_mread( (u_int8*)USM_BASE, G_buf ) != 0
+		|| memcmp( G_buf, G_usmImg, sizeof(G_usmImg) ) != 0;
+}
+
+static int op_usm_write( u_int32 i )
+{
+	u_int8 index = (u_int8)(16 + i % 16);
+
+	G_usmImg[index] = (u_int16)~G_usmImg[index];
+	return usm_write( (u_int8*)USM_BASE, index, G_usmImg[index] ) != 0;
+}
+
+static int op_usm_mwrite( u_int32 i )
+{
+	u_int32 n;
+
+	(void)i;
+	for( n=1; n<USM_EEPROM_WORDS; n++ )		/* keep magic word */
+		G_usmImg[n] = (u_int16)~G_usmImg[n];
+	return usm_mwrite( (u_int8*)USM_BASE, G_usmImg ) != 0;
+}
+
+static int op_mcrwReadEeprom( u_int32 i )
+{
+	MCRW_ENTRIES *ent = (MCRW_ENTRIES*)G_mcrwHdl;
+
+	(void)i;
+	if( ent->ReadEeprom( G_mcrwHdl, 0, G_buf,
+						 ID_MOD_EEPROM_WORDS * sizeof(u_int16) ) )
+		return 1;
+	return memcmp( G_buf, G_img, sizeof(G_img) ) != 0;
+}
+
+static int op_mcrwWriteEeprom( u_int32 i )
+{
+	MCRW_ENTRIES *ent = (MCRW_ENTRIES*)G_mcrwHdl;
+	u_int8 index = (u_int8)(32 + (i % 8) * 4);
+
+	G_img[index]   = (u_int16)~G_img[index];
+	G_img[index+1] = (u_int16)~G_img[index+1];
+	return ent->WriteEeprom( G_mcrwHdl, (u_int8)(index * 2), &G_img[index],
+							 2 * sizeof(u_int16) ) != 0;
+}
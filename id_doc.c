@@ -33,11 +33,41 @@ access the EEPROM to get the identification of the device / module.
 
 This library contains of:\n
  
- - MICROWIRE_PORT functions: MCRW_PORT_Init() \n
+ - MICROWIRE_PORT functions: MCRW_PORT_Init(), MCRW_PORT_WriteAll(),
+    MCRW_PORT_ReadEepromX(), MCRW_PORT_WriteEepromX(),
+    MCRW_PORT_WriteStart() \n
  - ID EEPROM read/write funcitons: 
-    m_mread(), m_mwrite(), m_getmodinfo(), m_write(), m_read()\n
+    m_mread(), m_mwrite(), m_getmodinfo(), m_write(), m_read(),
+    m_readburst(), m_writex(), m_mwritex(), m_writerange(),
+    m_writeall(), m_cacheflush(), m_cachestat(), m_readmulti(),
+    m_scanmodinfo(), m_writestart(), m_writemulti()\n
+ - timing functions: ID_TimeInit(), ID_TimeInfo(), ID_PollConfigSet(),
+    ID_PollConfigGet()\n
+ - bus access counters: ID_BusStatGet(), ID_BusStatReset()\n - locking: ID_LockInit(), ID_LockExit(); after ID_LockInit() every
+    EEPROM transaction holds the lock of its module register, so
+    different modules are accessed in parallel; the counters and the
+    m_getmodinfo() cache have their own locks\n
+
  - USM EEPROM read/write functions: 
-    usm_mread(), usm_mwrite(), usm_read(), usm_write() \n
+    usm_mread(), usm_mwrite(), usm_read(), usm_write(),
+    usm_readburst(), usm_writerange(), usm_writestart()\n
+ - non-blocking write: ID_WriteStep() advances a job started with
+    m_writestart(), usm_writestart() or MCRW_PORT_WriteStart() by one
+    step, so several EEPROMs can be programmed at the same time;
+    ID_WriteRun() runs a list of jobs round-robin\n
+
+The variant id_sim (library_sim.mak, switch ID_SIM) replaces the register
+accesses and delays by software models of the 93Cxx and USM EEPROMs with
+virtual time, so the library can be tested on a host (see id_sim.h):\n
+
+ - simulation: ID_SimInit(), ID_SimAttach(), ID_SimAttachModule(),
+    ID_SimAttachUsm(), ID_SimLoad(), ID_SimDump(), ID_SimBusy(),
+    ID_SimIdle(), ID_SimStatGet(), ID_SimStatReset()\n
+
+The host program id_bench (program_bench.mak) measures register accesses,
+delays, ready polling and time of every read/write function on the
+simulated EEPROMs and prints them as CSV. With -r=id_bench.ref it exits
+with 1 if any value exceeds the reference.\n
 
 
 */
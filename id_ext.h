@@ -0,0 +1,250 @@
+/***********************  I n c l u d e  -  F i l e  ************************
+ *
+ *         Name: id_ext.h
+ *
+ *       Author: kp
+ *
+ *  Description: Extended ID library interface
+ *
+ *               Prototypes and defines of the ID library functions that
+ *               are not part of the classic MEN/modcom.h and
+ *               MEN/microwire.h interface.
+ *
+ *     Switches: ID_SW - swapped access
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 1999-2019, MEN Mikro Elektronik GmbH
+ ******************************************************************************/
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _ID_EXT_H
+#define _ID_EXT_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#ifdef ID_SW
+#   define m_readburst      ID_SW_m_readburst
+#   define m_writex         ID_SW_m_writex
+#   define m_mwritex        ID_SW_m_mwritex
+#   define m_writerange     ID_SW_m_writerange
+#   define m_writeall       ID_SW_m_writeall
+#   define m_cacheflush     ID_SW_m_cacheflush
+#   define m_cachestat      ID_SW_m_cachestat
+#   define m_readmulti      ID_SW_m_readmulti
+#   define m_scanmodinfo    ID_SW_m_scanmodinfo
+#   define m_writestart     ID_SW_m_writestart
+#   define m_writemulti     ID_SW_m_writemulti
+#   define MCRW_PORT_WriteAll       MCRW_SW_PORT_WriteAll
+#   define MCRW_PORT_ReadEepromX    MCRW_SW_PORT_ReadEepromX
+#   define MCRW_PORT_WriteEepromX   MCRW_SW_PORT_WriteEepromX
+#   define MCRW_PORT_WriteStart     MCRW_SW_PORT_WriteStart
+#   define ID_TimeInit      ID_SW_TimeInit
+#   define ID_TimeInfo      ID_SW_TimeInfo
+#   define ID_PollConfigSet ID_SW_PollConfigSet
+#   define ID_PollConfigGet ID_SW_PollConfigGet
+#   define ID_BusStatGet    ID_SW_BusStatGet
+#   define ID_BusStatReset  ID_SW_BusStatReset
+#   define ID_LockInit      ID_SW_LockInit
+#   define ID_LockExit      ID_SW_LockExit
+#   define ID_WriteStep     ID_SW_WriteStep
+#   define ID_WriteRun      ID_SW_WriteRun
+#   define usm_readburst    ID_SW_usm_readburst
+#   define usm_writerange   ID_SW_usm_writerange
+#   define usm_writestart   ID_SW_usm_writestart
+#endif
+
+#define ID_MOD_EEPROM_WORDS	64		/* words of M-Module EEPROM (93C46) */
+#define USM_EEPROM_WORDS	128		/* words of USM EEPROM */
+
+#define ID_CACHE_ALL		((U_INT32_OR_64)~0)	/* m_cacheflush(): all
+											   modules (no valid base) */
+
+/*--- write flags for m_writex(), m_mwritex() ---*/
+#define ID_WF_NOERASE		0x0001	/* skip ERASE, WRITE erases itself */
+#define ID_WF_DIFF			0x0002	/* program only differing words */
+
+/*--- ready polling (ID_POLL.flags) ---*/
+#define ID_POLL_SLEEP		0x0001	/* sleep (OSS_Delay) for back-off >= 1ms,
+										   needs maxUs >= 1000 (the default
+										   ID_POLL_MAX_US never sleeps) */
+
+#define ID_POLL_TIMEOUT_US	10000	/* default max. write/erase time (T_WP) */
+#define ID_POLL_MIN_US		20		/* default first back-off */
+#define ID_POLL_MAX_US		500		/* default max. back-off */
+
+/*--- non-blocking write (ID_WriteStep()) ---*/
+#define ID_AW_DONE			0		/* all words written */
+#define ID_AW_BUSY			1		/* call ID_WriteStep() again */
+#define ID_AW_ERROR			2		/* failed, see ID_AWRITE.error */
+
+/*--- MCRW_DESC_PORT.flagsOut (ID lib extension) ---*/
+/* Evaluate address, size, mask, polarity and not read back defaults/mask
+   of each line, lines may be in separate registers. Without this flag
+   the lines are at the fixed bits 0x01 (DI/DO), 0x02 (CLK), 0x04 (CS),
+   high active, in the 16-bit DATA IN register (as before). */
+#define MCRW_DESC_PORT_FLAG_OUT_MAPPED	0x80
+
+/*--- MCRW_IOCTL_BUS_CLOCK (MCRW_DESC_PORT.busClock is u_int8: max. 255) ---*/
+#define MCRW_BUS_CLOCK_MAX		2000	/* max. bus clock [kHz] (93C46 SK) */
+
+/*--- additional MCRW setstat/getstat codes ---*/
+#define MCRW_IOCTL_ID_EXT		0x1000	/* base of ID lib specific codes */
+#define MCRW_IOCTL_WRITE_FLAGS	(MCRW_IOCTL_ID_EXT+0)	/* ID_WF_xxx */
+#define MCRW_IOCTL_POLL_TIMEOUT	(MCRW_IOCTL_ID_EXT+1)	/* timeout [us] */
+#define MCRW_IOCTL_POLL_MIN		(MCRW_IOCTL_ID_EXT+2)	/* first back-off [us] */
+#define MCRW_IOCTL_POLL_MAX		(MCRW_IOCTL_ID_EXT+3)	/* max. back-off [us] */
+#define MCRW_IOCTL_POLL_FLAGS	(MCRW_IOCTL_ID_EXT+4)	/* ID_POLL_xxx */
+#define MCRW_IOCTL_WRITTEN		(MCRW_IOCTL_ID_EXT+5)	/* words programmed by
+														   last write (get) */
+#define MCRW_IOCTL_BUS_WRITES	(MCRW_IOCTL_ID_EXT+6)	/* register writes of
+														   last access (get) */
+
+/*--- performance counters of the handle (get), not with ID_NO_STATS ---*/
+#define MCRW_IOCTL_STAT_WORDS_READ		(MCRW_IOCTL_ID_EXT+7)	/* words read */
+#define MCRW_IOCTL_STAT_WORDS_WRITTEN	(MCRW_IOCTL_ID_EXT+8)	/* words programmed */
+#define MCRW_IOCTL_STAT_BUS_ACCESSES	(MCRW_IOCTL_ID_EXT+9)	/* register
+																   accesses */
+#define MCRW_IOCTL_STAT_DELAY_US		(MCRW_IOCTL_ID_EXT+10)	/* delay and
+																   polling [us] */
+#define MCRW_IOCTL_STAT_POLLS			(MCRW_IOCTL_ID_EXT+11)	/* ready polls */
+#define MCRW_IOCTL_STAT_PROG_MAX_US		(MCRW_IOCTL_ID_EXT+12)	/* max. program
+																   time [us] */
+#define MCRW_IOCTL_STAT_VERIFY_ERRS		(MCRW_IOCTL_ID_EXT+13)	/* verify errors */
+#define MCRW_IOCTL_STAT_TIMEOUTS		(MCRW_IOCTL_ID_EXT+14)	/* ready timeouts */
+#define MCRW_IOCTL_STAT_RESET			(MCRW_IOCTL_ID_EXT+15)	/* clear (set) */
+
+/*--------------------------------------+
+|   TYPDEFS                             |
++--------------------------------------*/
+/** bit timing calibration result (see ID_TimeInfo()) */
+typedef struct
+{
+	u_int32	loopsPerMs;		/**< busy-wait loops per millisecond */
+	u_int32	mwHalfNs;		/**< Microwire half bit period [ns] */
+	u_int32	mwClockHz;		/**< resulting Microwire bus clock [Hz] */
+	u_int32	usmHalfNs;		/**< USM half bit period [ns] */
+	u_int32	usmClockHz;		/**< resulting USM bus clock [Hz] */
+} ID_TIME_INFO;
+
+/** ready polling configuration (see ID_PollConfigSet()) */
+typedef struct
+{
+	u_int32	timeoutUs;		/**< max. programming time [us] */
+	u_int32	minUs;			/**< first back-off between two samples [us] */
+	u_int32	maxUs;			/**< max. back-off, doubled up to this [us] */
+	u_int32	flags;			/**< ID_POLL_xxx */
+} ID_POLL;
+
+/** bit-bang register access counters (see ID_BusStatGet()) */
+typedef struct
+{
+	u_int32	transactions;	/**< completed EEPROM transactions */
+	u_int32	writes;			/**< register writes done */
+	u_int32	elided;			/**< register writes elided by the shadow */
+	u_int32	reads;			/**< register reads */
+	u_int32	lastWrites;		/**< register writes of last transaction */
+	u_int32	lastElided;		/**< writes elided in last transaction */
+	u_int32	lastReads;		/**< register reads of last transaction */
+} ID_BUS_STAT;
+
+/** non-blocking write job (see m_writestart(), ID_WriteStep()) */
+typedef struct ID_AWRITE
+{
+	int		(*step)( struct ID_AWRITE *job );	/**< protocol state machine */
+	OSS_HANDLE *osHdl;		/**< for tick (may be NULL) */
+	void	*hdl;			/**< MCRW handle (MCRW_PORT_WriteStart()) */
+	U_INT32_OR_64 base;		/**< module base (m_/usm_writestart()) */
+	u_int16	*buff;			/**< next word to write */
+	u_int32	index;			/**< next index to write */
+	u_int32	count;			/**< words left */
+	u_int32	flags;			/**< write flags (ID_WF_xxx) */
+	u_int32	state;			/**< protocol state (library internal) */
+	u_int32	start;			/**< start tick of current ready polling */
+	u_int32	ticks;			/**< ticks until timeout */
+	u_int32	polls;			/**< ready polls */
+	u_int32	written;		/**< words programmed */
+	u_int32	pollUs;			/**< suggested time until next step [us] */
+	int		error;			/**< error code of the blocking function */
+} ID_AWRITE;
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+/* M-Module ID EEPROM (c_drvadd.c) */
+extern int m_readburst( U_INT32_OR_64 base, u_int8 index, u_int8 count,
+						u_int16 *buff );
+extern int m_writex( u_int8 *addr, u_int8 index, u_int16 data,
+					 u_int32 flags );
+extern int m_mwritex( u_int8 *addr, u_int16 *buff, u_int32 flags );
+extern int m_writerange( u_int8 *addr, u_int8 index, u_int8 count,
+						 u_int16 *buff, u_int32 flags, u_int32 *writtenP );
+extern int m_writeall( u_int8 *addr, u_int16 *buff, u_int32 flags );
+extern void m_cacheflush( U_INT32_OR_64 base );
+extern void m_cachestat( u_int32 *hitsP, u_int32 *missesP );
+extern int m_readmulti( U_INT32_OR_64 *bases, u_int32 n, u_int8 index,
+						u_int8 count, u_int16 *buff );
+extern int m_scanmodinfo( U_INT32_OR_64 *bases, u_int32 n );
+extern int m_writestart( ID_AWRITE *job, u_int8 *addr, u_int8 index,
+						 u_int8 count, u_int16 *buff, u_int32 flags );
+extern int m_writemulti( U_INT32_OR_64 *bases, u_int32 n, u_int8 index,
+						 u_int8 count, u_int16 *buff, u_int32 flags,
+						 int *errors );
+
+/* Microwire port (microwire_port.c) */
+extern int32 MCRW_PORT_WriteAll( void *hdl, u_int16 *buf, u_int32 size );
+extern int32 MCRW_PORT_ReadEepromX( void *hdl, u_int32 addr, u_int16 *buf,
+									u_int32 size );
+extern int32 MCRW_PORT_WriteEepromX( void *hdl, u_int32 addr, u_int16 *buf,
+									 u_int32 size );
+extern int32 MCRW_PORT_WriteStart( ID_AWRITE *job, void *hdl, u_int32 addr,
+								   u_int16 *buf, u_int32 size );
+
+/* bit timing (id_time.c) */
+extern int32 ID_TimeInit( OSS_HANDLE *osHdl );
+extern void  ID_TimeInfo( ID_TIME_INFO *infoP );
+extern void  ID_PollConfigSet( const ID_POLL *pollP );
+extern void  ID_PollConfigGet( ID_POLL *pollP );
+
+/* bus access counters (id_util.c) */
+extern void  ID_BusStatGet( ID_BUS_STAT *statP );
+extern void  ID_BusStatReset( void );
+
+/* per register locking (id_util.c) */
+extern int32 ID_LockInit( OSS_HANDLE *osHdl );
+extern void  ID_LockExit( void );
+
+/* non-blocking write (id_util.c) */
+extern int   ID_WriteStep( ID_AWRITE *job );
+extern u_int32 ID_WriteRun( ID_AWRITE *jobs, u_int32 n );
+
+/* USM ID EEPROM (usmrw.c) */
+extern int usm_readburst( U_INT32_OR_64 base, u_int8 index, u_int8 count,
+						  u_int16 *buff );
+extern int usm_writerange( u_int8 *addr, u_int8 index, u_int8 count,
+						   u_int16 *buff, u_int32 flags, u_int32 *writtenP );
+extern int usm_writestart( ID_AWRITE *job, u_int8 *addr, u_int8 index,
+						   u_int8 count, u_int16 *buff, u_int32 flags );
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif	/* _ID_EXT_H */
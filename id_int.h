@@ -0,0 +1,187 @@
+/***********************  I n c l u d e  -  F i l e  ************************
+ *
+ *         Name: id_int.h
+ *
+ *       Author: kp
+ *
+ *  Description: ID library internal defines and prototypes
+ *
+ *               Shared between the modules of the library only,
+ *               not to be included by library users.
+ *
+ *     Switches: ID_SW  - swapped access
+ *               ID_SIM - simulated register backend (see id_sim.c)
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 1999-2019, MEN Mikro Elektronik GmbH
+ ******************************************************************************/
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _ID_INT_H
+#define _ID_INT_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#ifdef ID_SW
+#   define ID_DelayNs       ID_SW_DelayNs
+#   define ID_TimeCheck     ID_SW_TimeCheck
+#   define ID_WaitStart     ID_SW_WaitStart
+#   define ID_WaitNext      ID_SW_WaitNext
+#   define ID_PollStart     ID_SW_PollStart
+#   define ID_PollExpired   ID_SW_PollExpired
+#   define ID_FillValue     ID_SW_FillValue
+#   define ID_BusOpen       ID_SW_BusOpen
+#   define ID_BusOpenX      ID_SW_BusOpenX
+#   define ID_BusClose      ID_SW_BusClose
+#   define ID_BusWrite      ID_SW_BusWrite
+#   define ID_BusRead       ID_SW_BusRead
+#   define ID_LockMask      ID_SW_LockMask
+#   define ID_Lock          ID_SW_Lock
+#   define ID_Unlock        ID_SW_Unlock
+#   define ID_LockAux       ID_SW_LockAux
+#   define ID_UnlockAux     ID_SW_UnlockAux
+#endif
+
+/*--- bus timing (datasheet minimum values) ---*/
+#define ID_T_MW_HALF_NS		1000	/* Microwire SK high/low time (93C46) */
+#define ID_T_USM_HALF_NS	4700	/* USM two-wire SCL low/high time */
+
+#define ID_ERASED_WORD		0xffff	/* content of an erased word */
+
+#define ID_BUS_UNKNOWN		0xffffffff	/* ID_BUS.shadow: register state unknown */
+
+#define ID_LOCK_SLOTS		32		/* lock table size (bits of a lock mask) */
+
+/*--- locks of shared library data (see ID_LockAux()) ---*/
+#define ID_AUX_CACHE		0		/* m_getmodinfo() cache */
+#define ID_AUX_STAT			1		/* ID_BUS_STAT counters */
+#define ID_AUX_LOCKS		2
+
+/*--- simulated backend: route register accesses to the models ---*/
+#ifdef ID_SIM
+#	undef MREAD_D8
+#	undef MREAD_D16
+#	undef MREAD_D32
+#	undef MWRITE_D8
+#	undef MWRITE_D16
+#	undef MWRITE_D32
+#	define MREAD_D8(ma,offs)		\
+		((u_int8)ID_SimRead( (U_INT32_OR_64)(ma)+(offs), 8 ))
+#	define MREAD_D16(ma,offs)		\
+		((u_int16)ID_SimRead( (U_INT32_OR_64)(ma)+(offs), 16 ))
+#	define MREAD_D32(ma,offs)		\
+		(ID_SimRead( (U_INT32_OR_64)(ma)+(offs), 32 ))
+#	define MWRITE_D8(ma,offs,val)	\
+		ID_SimWrite( (U_INT32_OR_64)(ma)+(offs), 8, (u_int32)(val) )
+#	define MWRITE_D16(ma,offs,val)	\
+		ID_SimWrite( (U_INT32_OR_64)(ma)+(offs), 16, (u_int32)(val) )
+#	define MWRITE_D32(ma,offs,val)	\
+		ID_SimWrite( (U_INT32_OR_64)(ma)+(offs), 32, (u_int32)(val) )
+#endif
+
+/*--- inline access of a fixed 16-bit register (M-Module/USM MODREG) ---*/
+/* Same shadow and counters as ID_BusWrite()/ID_BusRead(), but with a
+   constant <reg> the access is a plain MWRITE_D16()/MREAD_D16(): no call
+   and no access function of ID_BusOpenX(). <val> is evaluated twice. */
+#define ID_BUS_WRITE_D16(bus,reg,val)						\
+	do {													\
+		if( (u_int32)(val) == (bus)->shadow )				\
+			(bus)->elided++;								\
+		else {												\
+			MWRITE_D16( (bus)->base, reg, (u_int16)(val) );	\
+			(bus)->shadow = (u_int32)(val);					\
+			(bus)->writes++;								\
+		}													\
+	} while(0)
+
+#define ID_BUS_READ_D16(bus,reg)							\
+	((bus)->reads++, (u_int32)MREAD_D16( (bus)->base, reg ))
+
+/*--------------------------------------+
+|   TYPDEFS                             |
++--------------------------------------*/
+/** state of one ready polling (see ID_WaitStart()) */
+typedef struct
+{
+	OSS_HANDLE		*osHdl;		/* for tick and sleep */
+	const ID_POLL	*poll;		/* polling configuration */
+	u_int32			start;		/* start tick */
+	u_int32			ticks;		/* ticks until deadline */
+	u_int32			backoffUs;	/* current back-off */
+	u_int32			waitedUs;	/* accumulated back-off */
+	u_int32			count;		/* number of back-offs */
+} ID_WAIT;
+
+/** bit-bang register access context of one transaction (see ID_BusOpen()) */
+typedef struct ID_BUS
+{
+	U_INT32_OR_64	base;		/* base address */
+	u_int32			reg;		/* register offset */
+	void			(*wr)( struct ID_BUS *bus, u_int32 val );	/* access width */
+	u_int32			(*rd)( struct ID_BUS *bus );
+	u_int32			shadow;		/* last value written or ID_BUS_UNKNOWN */
+	u_int32			writes;		/* register writes */
+	u_int32			elided;		/* writes elided (no line changed) */
+	u_int32			reads;		/* register reads */
+	u_int32			lock;		/* lock mask held (see ID_Lock()) */
+	u_int32			slots;		/* buses driven in lockstep from this one
+								   (c_drvadd.c), else 1 */
+} ID_BUS;
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+/* id_time.c */
+extern void ID_DelayNs( u_int32 ns );
+extern void ID_TimeCheck( OSS_HANDLE *osHdl );
+extern void ID_WaitStart( OSS_HANDLE *osHdl, const ID_POLL *poll,
+						  ID_WAIT *waitP );
+extern int  ID_WaitNext( ID_WAIT *waitP );
+extern void ID_PollStart( ID_AWRITE *job, const ID_POLL *poll );
+extern int  ID_PollExpired( ID_AWRITE *job );
+
+/* id_util.c */
+extern u_int16 ID_FillValue( const u_int16 *buf, u_int32 count,
+							  u_int32 flags );
+extern void    ID_BusOpen( ID_BUS *bus, U_INT32_OR_64 base, u_int32 reg );
+extern void    ID_BusOpenX( ID_BUS *bus, U_INT32_OR_64 base, u_int32 reg,
+							u_int32 width );
+extern void    ID_BusClose( ID_BUS *bus );
+extern void    ID_BusWrite( ID_BUS *bus, u_int32 val );
+extern u_int32 ID_BusRead( ID_BUS *bus );
+extern u_int32 ID_LockMask( U_INT32_OR_64 addr );
+extern void    ID_Lock( u_int32 mask );
+extern void    ID_Unlock( u_int32 mask );
+extern void    ID_LockAux( u_int32 n );
+extern void    ID_UnlockAux( u_int32 n );
+
+#ifdef ID_SIM
+/* id_sim.c */
+extern u_int32 ID_SimRead( U_INT32_OR_64 addr, u_int32 width );
+extern void    ID_SimWrite( U_INT32_OR_64 addr, u_int32 width, u_int32 val );
+extern void    ID_SimDelay( u_int32 ns );
+#endif
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif	/* _ID_INT_H */
@@ -0,0 +1,263 @@
+/***********************  I n c l u d e  -  F i l e  ************************
+ *
+ *         Name: id_mw.h
+ *
+ *       Author: kp
+ *
+ *  Description: Microwire bit-bang engine of the ID library (included
+ *               source)
+ *
+ *               The 93Cxx frame routines are defined here once and
+ *               specialized by the including module through the macros
+ *               below. The line state is always B_SEL|B_CLK|B_DAT
+ *               (0x04/0x02/0x01); the macros map it to the registers.
+ *               c_drvadd.c maps them to inline 16-bit accesses of the
+ *               fixed module register (ID_BUS_WRITE_D16()) and the fixed
+ *               93C46 instruction length, so each edge is one shadow
+ *               compare and one register write per module (several
+ *               modules in lockstep, see ID_BUS.slots). The descriptor port of
+ *               microwire_port.c keeps ID_BusWrite()/ID_BusRead() with
+ *               the access function of the register width selected at
+ *               run time.
+ *
+ *               Parameters (must be defined before the include):
+ *
+ *               ID_MW_HDL				handle type
+ *               ID_MW_OUT(h,state)		output line state
+ *               ID_MW_IN(h)			state of DO (0/1)
+ *               ID_MW_DELAY(h)			half bit period delay
+ *               ID_MW_CODEBITS(h)		instruction bits after the start
+ *										bit (2 opcode + address bits)
+ *               ID_MW_READ(h,index)	READ instruction of <index>
+ *
+ *               Instructions and write data are replayed from a table of
+ *               line states per nibble (G_mwWave), so no bit is shifted
+ *               and masked at run time.
+ *
+ *     Switches: none
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 1999-2019, MEN Mikro Elektronik GmbH
+ ******************************************************************************/
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _ID_MW_H
+#define _ID_MW_H
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+/* line state */
+#define B_DAT	0x01				/* data in-;output		*/
+#define B_CLK	0x02				/* clock				*/
+#define B_SEL	0x04				/* chip-select			*/
+
+/* waveform of one bit: clock low with data, clock high with data */
+#define MW_BIT(d)	(d)|B_SEL, (d)|B_CLK|B_SEL
+#define MW_NIB(n)	{ MW_BIT(((n)>>3)&1), MW_BIT(((n)>>2)&1), \
+					  MW_BIT(((n)>>1)&1), MW_BIT((n)&1) }
+
+/*--------------------------------------+
+|   STATICS                             |
++--------------------------------------*/
+/** line states of the 4 bits of a nibble (MSB first), see _frameout() */
+static const u_int8 G_mwWave[16][8] = {
+	MW_NIB(0x0), MW_NIB(0x1), MW_NIB(0x2), MW_NIB(0x3),
+	MW_NIB(0x4), MW_NIB(0x5), MW_NIB(0x6), MW_NIB(0x7),
+	MW_NIB(0x8), MW_NIB(0x9), MW_NIB(0xa), MW_NIB(0xb),
+	MW_NIB(0xc), MW_NIB(0xd), MW_NIB(0xe), MW_NIB(0xf)
+};
+
+/*----------------------------------------------------------------------
+ * LOW-LEVEL ROUTINES FOR SERIAL EEPROM
+ *--------------------------------------------------------------------*/
+
+/******************************* _select ***********************************/
+/**   Select EEPROM:
+ *                 output DI/CLK/CS low
+ *                 delay
+ *                 output CS high and data bit
+ *                 delay
+ *                 (Note: the data bit is the low phase of the start bit
+ *                  clock, so _opcode() needs no extra write for it.
+ *                  After _deselect() the first write is elided by the
+ *                  shadow, see ID_BusWrite().)
+ *---------------------------------------------------------------------------
+ *  \param h			\IN handle
+ *	\param dbs			\IN	data bit to present with CS
+ *
+ ***************************************************************************/
+static void _select( ID_MW_HDL *h, u_int8 dbs )
+{
+    ID_MW_OUT( h, 0 );						/* everything inactive */
+    ID_MW_DELAY( h );
+    ID_MW_OUT( h, dbs|B_SEL );				/* select high */
+    ID_MW_DELAY( h );
+}
+
+/******************************* _deselect *********************************/
+/**   Deselect EEPROM
+ *                 output CS low
+ *---------------------------------------------------------------------------
+ *  \param h			\IN handle
+ *
+ ***************************************************************************/
+static void _deselect( ID_MW_HDL *h )
+{
+    ID_MW_OUT( h, 0 );						/* everything inactive */
+}
+
+/******************************* _clockout ********************************/
+/**   Output data bit (send only):
+ *                 output clock low
+ *                 output data bit
+ *                 delay
+ *                 output clock high
+ *                 delay
+ *                 (Note: keep CS asserted)
+ *---------------------------------------------------------------------------
+ *  \param h			\IN handle
+ *	\param dbs			\IN	data bit to send
+ *
+ ***************************************************************************/
+static void _clockout( ID_MW_HDL *h, u_int8 dbs )
+{
+    ID_MW_OUT( h, dbs|B_SEL );				/* output clock low */
+											/* output data high/low */
+    ID_MW_DELAY( h );
+
+    ID_MW_OUT( h, dbs|B_CLK|B_SEL );		/* output clock high */
+    ID_MW_DELAY( h );
+}
+
+/******************************* _clock ***********************************/
+/**   Output data bit and sample DO:
+ *                 see _clockout()
+ *                 return state of data serial eeprom's DO - line
+ *                 (Note: keep CS asserted)
+ *---------------------------------------------------------------------------
+ *  \param h			\IN handle
+ *	\param dbs			\IN	data bit to send
+ *  \return state of DO line
+ *
+ ***************************************************************************/
+static int _clock( ID_MW_HDL *h, u_int8 dbs )
+{
+    _clockout( h, dbs );
+
+    return( ID_MW_IN( h ) );				/* get data */
+}
+
+/******************************* _frameout ********************************/
+/**   Output <bits> bits of <code> (MSB first, send only)
+ *
+ *    Same edges as _clockout() per bit, but the line states are
+ *    replayed from G_mwWave nibble by nibble, a leading partial nibble
+ *    starts within its table row.
+ *    (Note: keep CS asserted)
+ *---------------------------------------------------------------------------
+ *  \param h			\IN handle
+ *	\param code			\IN bits to send
+ *	\param bits			\IN number of bits
+ *
+ ***************************************************************************/
+static void _frameout( ID_MW_HDL *h, u_int32 code, int bits )
+{
+    register const u_int8   *st;			/* line states  */
+    register int            n;				/* edges        */
+
+    while( bits > 0 )
+    {
+        n = (bits & 3) ? (bits & 3) : 4;	/* bits of this nibble */
+        bits -= n;
+        st = &G_mwWave[(code >> bits) & 0xf][2 * (4 - n)];
+
+        for( n *= 2; n; n--, st++ ){
+            ID_MW_OUT( h, *st );
+            ID_MW_DELAY( h );
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+ * HIGH-LEVEL ROUTINES FOR SERIAL EEPROM
+ *--------------------------------------------------------------------*/
+
+/******************************* _opcode ***********************************/
+/**   Output instruction with leading startbit
+ *
+ *---------------------------------------------------------------------------
+ *  \param h			\IN handle
+ *	\param code			\IN instruction (ID_MW_CODEBITS() bits)
+ *
+ ***************************************************************************/
+static void _opcode( ID_MW_HDL *h, u_int32 code )
+{
+    _select( h, 1 );						/* DI = start bit */
+    ID_MW_OUT( h, 1|B_CLK|B_SEL );			/* clock in start bit */
+    ID_MW_DELAY( h );
+
+    _frameout( h, code, (int)ID_MW_CODEBITS(h) );	/* output instruction */
+}
+
+/******************************* _writeop *********************************/
+/**   Send WRITE or WRAL with data, the programming cycle starts with
+ *    the deselect
+ *
+ *---------------------------------------------------------------------------
+ *  \param h			\IN handle
+ *	\param code			\IN instruction (WRITE+index or WRAL)
+ *	\param data			\IN word to write
+ *
+ ***************************************************************************/
+static void _writeop( ID_MW_HDL *h, u_int32 code, u_int16 data )
+{
+    _opcode( h, code );						/* select write */
+    _frameout( h, data, 16 );				/* write data */
+    _deselect( h );
+}
+
+/******************************* _readburst ********************************/
+/**   Sequential read of <count> words starting at <index>
+ *
+ *    One READ instruction, then the data of all words is clocked out
+ *    continuously. The dummy zero bit of the EEPROM is shifted out
+ *    together with the last address bit, so the data words follow
+ *    without any gap.
+ *---------------------------------------------------------------------------
+ *  \param h			\IN handle
+ *	\param index		\IN first index to read
+ *	\param count		\IN number of words to read
+ *	\param buff			\OUT user buffer (count words)
+ *
+ ***************************************************************************/
+static void _readburst( ID_MW_HDL *h, u_int32 index, int count,
+                        u_int16 *buff )
+{
+    register u_int16    wx;					/* data word    */
+    register int        i;					/* counter      */
+
+    _opcode( h, ID_MW_READ(h,index) );
+    while( count-- )
+    {
+        for( wx=0, i=0; i<16; i++ )
+            wx = (u_int16)((wx<<1) + _clock( h, 0 ));
+        *buff++ = wx;
+    }
+    _deselect( h );
+}
+
+#endif	/* _ID_MW_H */
@@ -0,0 +1,1055 @@
+/*********************  P r o g r a m  -  M o d u l e **********************/
+/*!
+ *         \file id_sim.c
+ *      Project: ID LIB
+ *
+ *       \author kp
+ *
+ *        \brief Simulated EEPROM backend (variant id_sim)
+ *
+ *               Software models of the 93Cxx Microwire EEPROM (x16) and
+ *               of the USM two-wire EEPROM behind the bit-bang registers.
+ *               With ID_SIM, id_int.h routes MREAD_Dx/MWRITE_Dx to
+ *               ID_SimRead()/ID_SimWrite() and ID_DelayNs() to
+ *               ID_SimDelay().
+ *
+ *               The models evaluate every register write for line edges
+ *               (CS, clock, data, start/stop condition) and run the
+ *               device state machine. Time is virtual: it advances only
+ *               by delays, sleeps and a fixed time per register access,
+ *               so the programming busy time is reproducible.
+ *
+ *               This module also provides the OSS functions used by
+ *               the library (delay, tick, memory, semaphore), so the
+ *               id_sim library runs as an ordinary host process without
+ *               OSS. The process has one task: a semaphore wait that
+ *               would block is a deadlock of the library and counted.
+ *
+ *     Required: -
+ *     Switches: ID_SIM
+ */
+ /*---------------------------[ Public Functions ]----------------------------
+ *
+ * void  ID_SimInit(accessNs)        remove all devices, clear time/counters
+ * int32 ID_SimAttach(devP)          add simulated device
+ * int32 ID_SimAttachModule(base)    add M-Module 93C46 at base
+ * int32 ID_SimAttachUsm(base)       add USM EEPROM at base
+ * int32 ID_SimLoad(dev,buf,words)   set EEPROM contents
+ * int32 ID_SimDump(dev,buf,words)   get EEPROM contents
+ * int   ID_SimBusy(dev)             check programming cycle
+ * void  ID_SimIdle()                let all programming cycles finish
+ * void  ID_SimStatGet(statP)        get simulation counters
+ * void  ID_SimStatReset()           clear simulation counters
+ * u_int32 ID_SimRead(addr,width)    register read (library internal)
+ * void  ID_SimWrite(addr,width,val) register write (library internal)
+ * void  ID_SimDelay(ns)             delay (library internal)
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 1999-2019, MEN Mikro Elektronik GmbH
+ ******************************************************************************/
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "id_var.h"
+#include <MEN/men_typs.h>
+#include <MEN/dbg.h>
+#include <MEN/oss.h>
+#include <MEN/maccess.h>
+#include "id_ext.h"
+#include "id_int.h"
+#include "id_sim.h"
+
+/*-----------------------------------------+
+|  DEFINES & CONST                         |
++-----------------------------------------*/
+#define MODREG			0xfe	/* ID register of M-Module and USM */
+
+#define SIM_WORDS_MAX	2048	/* 93Cxx: max. words (11 address bits) */
+#define SIM_BYTES_MAX	4096	/* USM: max. bytes */
+
+/* line levels (bit n = ID_SIM_xx line n) */
+#define L_CS			(1<<ID_SIM_CS)
+#define L_SK			(1<<ID_SIM_SK)
+#define L_DI			(1<<ID_SIM_DI)
+
+/*--- 93Cxx ---*/
+#define MW_READ			2		/* opcodes */
+#define MW_WRITE		1
+#define MW_ERASE		3
+#define MW_EXT			0
+#define MW_EWEN			3		/* MW_EXT subcodes (2 address MSBs) */
+#define MW_ERAL			2
+#define MW_WRAL			1
+#define MW_EWDS			0
+#define MW_OP_ERAL		4		/* SIM_DEV.op of ERAL/WRAL */
+#define MW_OP_WRAL		5
+
+#define MW_S_START		0		/* wait for start bit, DO = ready */
+#define MW_S_CMD		1		/* opcode and address */
+#define MW_S_DATA		2		/* data word of WRITE/WRAL */
+#define MW_S_READ		3		/* shift out data */
+#define MW_S_IGNORE		4		/* wait for CS low */
+
+/*--- USM ---*/
+#define USM_DEVADDR		0xae	/* device address, R/W = bit 0 */
+
+#define U_S_IDLE		0		/* wait for start condition */
+#define U_S_RX			1		/* receive byte, then acknowledge */
+#define U_S_TX			2		/* send byte, then get acknowledge */
+
+#define U_B_DEVADDR		0		/* SIM_DEV.what: byte received */
+#define U_B_WORDADDR	1
+#define U_B_DATA		2
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/** simulated register */
+typedef struct
+{
+	U_INT32_OR_64	addr;		/* register address */
+	u_int32			val;		/* last value written */
+} SIM_REG;
+
+/** simulated device */
+typedef struct
+{
+	ID_SIM_DEV		cfg;		/* configuration */
+	SIM_REG			*reg[ID_SIM_LINES];	/* register of each line */
+	u_int32			level;		/* current line levels L_xx */
+	u_int32			out;		/* DO/SDA driven by device (1=high) */
+	u_int64			busyUntil;	/* end of programming cycle */
+	u_int64			lastEdge;	/* time of last clock edge */
+	u_int32			state;		/* protocol state xx_S_xx */
+	u_int32			bits;		/* bits shifted in current unit */
+	u_int32			shift;		/* shift register */
+	u_int32			addr;		/* address counter */
+	u_int32			op;			/* 93C: pending operation */
+	u_int32			ewen;		/* 93C: erase/write enabled */
+	u_int32			pend;		/* 93C: op to run at CS low,
+								   USM: bytes to write at stop */
+	u_int32			what;		/* USM: kind of byte received */
+	u_int32			ack;		/* USM: acknowledge of current byte */
+	u_int32			next;		/* USM: state after acknowledge */
+	u_int16			word[SIM_WORDS_MAX];	/* 93C contents */
+	u_int8			byte[SIM_BYTES_MAX];	/* USM contents */
+	u_int8			page[SIM_BYTES_MAX];	/* USM page buffer */
+	u_int8			pflag[SIM_BYTES_MAX];	/* USM page buffer used */
+} SIM_DEV;
+
+/*-----------------------------------------+
+|  STATICS                                 |
++-----------------------------------------*/
+static SIM_REG		G_reg[ID_SIM_REG_MAX];
+static u_int32		G_nReg;
+static SIM_DEV		G_dev[ID_SIM_DEV_MAX];
+static u_int32		G_nDev;
+static u_int32		G_accessNs;
+static ID_SIM_STAT	G_stat;
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+static SIM_REG *_reg( U_INT32_OR_64 addr );
+static u_int32 _mask( u_int32 width );
+static int  _busy( SIM_DEV *dev );
+static void _edge( SIM_DEV *dev );
+static void _mwedge( SIM_DEV *dev, u_int32 old, u_int32 new );
+static void _mwclock( SIM_DEV *dev, u_int32 di );
+static void _mwexec( SIM_DEV *dev );
+static void _mwprog( SIM_DEV *dev );
+static void _usmedge( SIM_DEV *dev, u_int32 old, u_int32 new );
+static void _usmrise( SIM_DEV *dev, u_int32 di );
+static void _usmfall( SIM_DEV *dev );
+static void _usmbyte( SIM_DEV *dev );
+static void _usmstop( SIM_DEV *dev );
+
+/******************************* ID_SimInit ********************************/
+/**   Remove all simulated devices and registers, clear time and counters.
+ *
+ *---------------------------------------------------------------------------
+ *  \param accessNs		\IN time of one register access [ns]
+ *
+ ****************************************************************************/
+void ID_SimInit( u_int32 accessNs )
+{
+	memset( G_reg, 0, sizeof(G_reg) );
+	memset( G_dev, 0, sizeof(G_dev) );
+	memset( &G_stat, 0, sizeof(G_stat) );
+	G_nReg = 0;
+	G_nDev = 0;
+	G_accessNs = accessNs;
+}
+
+/******************************* ID_SimAttach ******************************/
+/**   Add a simulated device.
+ *
+ *    The EEPROM is erased (0xFFFF) and write disabled. Zero values of
+ *    size, pageSize, progNs and minHalfNs select the defaults of the
+ *    device type. All lines are high active.
+ *
+ *---------------------------------------------------------------------------
+ *  \param devP			\IN device configuration
+ *  \return   device number or -1 on error
+ *
+ ****************************************************************************/
+int32 ID_SimAttach( const ID_SIM_DEV *devP )
+{
+	SIM_DEV		*dev;
+	u_int32		l;
+
+	if( G_nDev >= ID_SIM_DEV_MAX )
+		return -1;
+
+	dev = &G_dev[G_nDev];
+	memset( dev, 0, sizeof(*dev) );
+	dev->cfg = *devP;
+
+	switch( devP->type ){
+	case ID_SIM_93C:
+		if( devP->addrLength < 2
+			|| (1UL << devP->addrLength) > SIM_WORDS_MAX )
+			return -1;
+		if( !dev->cfg.size || dev->cfg.size > (1UL << devP->addrLength) )
+			dev->cfg.size = 1UL << devP->addrLength;
+		if( !dev->cfg.progNs )
+			dev->cfg.progNs = ID_SIM_93C_T_WP_NS;
+		if( !dev->cfg.minHalfNs )
+			dev->cfg.minHalfNs = ID_SIM_93C_T_SK_NS;
+		dev->state = MW_S_START;
+		break;
+	case ID_SIM_USM:
+		if( !dev->cfg.size )
+			dev->cfg.size = ID_SIM_USM_BYTES;
+		if( !dev->cfg.pageSize )
+			dev->cfg.pageSize = ID_SIM_USM_PAGE;
+		if( dev->cfg.size > SIM_BYTES_MAX
+			|| (dev->cfg.pageSize & (dev->cfg.pageSize-1)) )
+			return -1;
+		if( !dev->cfg.progNs )
+			dev->cfg.progNs = ID_SIM_USM_T_WR_NS;
+		if( !dev->cfg.minHalfNs )
+			dev->cfg.minHalfNs = ID_SIM_USM_T_SCL_NS;
+		dev->state = U_S_IDLE;
+		break;
+	default:
+		return -1;
+	}
+
+	for( l=0; l<ID_SIM_LINES; l++ )
+		if( (dev->reg[l] = _reg( devP->line[l].addr )) == NULL )
+			return -1;
+
+	memset( dev->word, 0xff, sizeof(dev->word) );
+	memset( dev->byte, 0xff, sizeof(dev->byte) );
+	dev->out = 1;
+
+	return (int32)G_nDev++;
+}
+
+/******************************* ID_SimAttachModule ************************/
+/**   Add a 93C46 at the ID register of an M-Module (see c_drvadd.c).
+ *
+ *---------------------------------------------------------------------------
+ *  \param base			\IN module base address
+ *  \return   device number or -1 on error
+ *
+ ****************************************************************************/
+int32 ID_SimAttachModule( U_INT32_OR_64 base )
+{
+	ID_SIM_DEV	dev;
+
+	memset( &dev, 0, sizeof(dev) );
+	dev.type = ID_SIM_93C;
+	dev.line[ID_SIM_CS].addr = base + MODREG;
+	dev.line[ID_SIM_CS].mask = 0x04;
+	dev.line[ID_SIM_SK].addr = base + MODREG;
+	dev.line[ID_SIM_SK].mask = 0x02;
+	dev.line[ID_SIM_DI].addr = base + MODREG;
+	dev.line[ID_SIM_DI].mask = 0x01;
+	dev.line[ID_SIM_DO].addr = base + MODREG;
+	dev.line[ID_SIM_DO].mask = 0x01;
+	dev.addrLength = 6;
+	dev.size       = ID_MOD_EEPROM_WORDS;
+
+	return ID_SimAttach( &dev );
+}
+
+/******************************* ID_SimAttachUsm ***************************/
+/**   Add a USM EEPROM at the ID register of a USM (see usmrw.c).
+ *
+ *---------------------------------------------------------------------------
+ *  \param base			\IN module base address
+ *  \return   device number or -1 on error
+ *
+ ****************************************************************************/
+int32 ID_SimAttachUsm( U_INT32_OR_64 base )
+{
+	ID_SIM_DEV	dev;
+
+	memset( &dev, 0, sizeof(dev) );
+	dev.type = ID_SIM_USM;
+	dev.line[ID_SIM_CS].addr = base + MODREG;
+	dev.line[ID_SIM_CS].mask = 0x20;
+	dev.line[ID_SIM_SK].addr = base + MODREG;
+	dev.line[ID_SIM_SK].mask = 0x10;
+	dev.line[ID_SIM_DI].addr = base + MODREG;
+	dev.line[ID_SIM_DI].mask = 0x08;
+	dev.line[ID_SIM_DO].addr = base + MODREG;
+	dev.line[ID_SIM_DO].mask = 0x08;
+
+	return ID_SimAttach( &dev );
+}
+
+/******************************* ID_SimLoad ********************************/
+/**   Set the EEPROM contents (USM: big endian words).
+ *
+ *---------------------------------------------------------------------------
+ *  \param dev			\IN device number
+ *  \param buf			\IN words to store from address 0
+ *  \param words		\IN number of words
+ *  \return   0=ok, -1=illegal device or size
+ *
+ ****************************************************************************/
+int32 ID_SimLoad( int32 dev, const u_int16 *buf, u_int32 words )
+{
+	SIM_DEV	*d = &G_dev[dev];
+	u_int32	i;
+
+	if( dev < 0 || (u_int32)dev >= G_nDev )
+		return -1;
+
+	if( d->cfg.type == ID_SIM_93C ){
+		if( words > d->cfg.size )
+			return -1;
+		for( i=0; i<words; i++ )
+			d->word[i] = buf[i];
+	}
+	else {
+		if( words * 2 > d->cfg.size )
+			return -1;
+		for( i=0; i<words; i++ ){
+			d->byte[2*i]   = (u_int8)(buf[i] >> 8);
+			d->byte[2*i+1] = (u_int8)buf[i];
+		}
+	}
+	return 0;
+}
+
+/******************************* ID_SimDump ********************************/
+/**   Get the EEPROM contents (USM: big endian words).
+ *
+ *---------------------------------------------------------------------------
+ *  \param dev			\IN device number
+ *  \param buf			\OUT words from address 0
+ *  \param words		\IN number of words
+ *  \return   0=ok, -1=illegal device or size
+ *
+ ****************************************************************************/
+int32 ID_SimDump( int32 dev, u_int16 *buf, u_int32 words )
+{
+	SIM_DEV	*d = &G_dev[dev];
+	u_int32	i;
+
+	if( dev < 0 || (u_int32)dev >= G_nDev )
+		return -1;
+
+	if( d->cfg.type == ID_SIM_93C ){
+		if( words > d->cfg.size )
+			return -1;
+		for( i=0; i<words; i++ )
+			buf[i] = d->word[i];
+	}
+	else {
+		if( words * 2 > d->cfg.size )
+			return -1;
+		for( i=0; i<words; i++ )
+			buf[i] = (u_int16)((d->byte[2*i] << 8) | d->byte[2*i+1]);
+	}
+	return 0;
+}
+
+/******************************* ID_SimBusy ********************************/
+/**   Check if a device is in its programming cycle.
+ *
+ *---------------------------------------------------------------------------
+ *  \param dev			\IN device number
+ *  \return   1=busy, 0=ready or illegal device
+ *
+ ****************************************************************************/
+int ID_SimBusy( int32 dev )
+{
+	if( dev < 0 || (u_int32)dev >= G_nDev )
+		return 0;
+
+	return _busy( &G_dev[dev] );
+}
+
+/******************************* ID_SimIdle ********************************/
+/**   Advance the virtual time until all programming cycles are finished.
+ *
+ *    Not counted as delay. Used between two measurements.
+ *
+ ****************************************************************************/
+void ID_SimIdle( void )
+{
+	u_int32 i;
+
+	for( i=0; i<G_nDev; i++ )
+		if( G_dev[i].busyUntil > G_stat.nowNs )
+			G_stat.nowNs = G_dev[i].busyUntil;
+}
+
+/******************************* ID_SimStatGet *****************************/
+/**   Get the simulation counters.
+ *
+ *---------------------------------------------------------------------------
+ *  \param statP		\OUT counters
+ *
+ ****************************************************************************/
+void ID_SimStatGet( ID_SIM_STAT *statP )
+{
+	*statP = G_stat;
+}
+
+/******************************* ID_SimStatReset ***************************/
+/**   Clear the simulation counters. The virtual time keeps running.
+ *
+ ****************************************************************************/
+void ID_SimStatReset( void )
+{
+	u_int64 now = G_stat.nowNs;
+
+	memset( &G_stat, 0, sizeof(G_stat) );
+	G_stat.nowNs = now;
+}
+
+/******************************* ID_SimRead ********************************/
+/**   Register read: latched value, DO/SDA lines driven by the devices.
+ *
+ *    A Microwire DO bit shows the device output, a two-wire SDA bit is
+ *    the wired AND of master and device.
+ *
+ *---------------------------------------------------------------------------
+ *  \param addr			\IN register address
+ *  \param width		\IN access width 8/16/32
+ *  \return   register value
+ *
+ ****************************************************************************/
+u_int32 ID_SimRead( U_INT32_OR_64 addr, u_int32 width )
+{
+	SIM_REG	*reg = _reg( addr );
+	SIM_DEV	*dev;
+	u_int32	val, out, i;
+
+	G_stat.reads++;
+	G_stat.nowNs += G_accessNs;
+
+	if( reg == NULL )
+		return _mask( width );
+
+	val = reg->val;
+	for( i=0; i<G_nDev; i++ ){
+		dev = &G_dev[i];
+		if( dev->reg[ID_SIM_DO] != reg )
+			continue;
+
+		if( _busy( dev ) )
+			G_stat.busyReads++;
+
+		if( dev->cfg.type == ID_SIM_93C ){
+			out = dev->out;
+			if( (dev->level & L_CS) && dev->state == MW_S_START )
+				out = !_busy( dev );		/* ready/busy status */
+
+			val &= ~dev->cfg.line[ID_SIM_DO].mask;
+			if( out )
+				val |= dev->cfg.line[ID_SIM_DO].mask;
+		}
+		else if( !dev->out )
+			val &= ~dev->cfg.line[ID_SIM_DO].mask;
+	}
+
+	return val & _mask( width );
+}
+
+/******************************* ID_SimWrite *******************************/
+/**   Register write: latch value and run the attached devices.
+ *
+ *---------------------------------------------------------------------------
+ *  \param addr			\IN register address
+ *  \param width		\IN access width 8/16/32
+ *  \param val			\IN value to write
+ *
+ ****************************************************************************/
+void ID_SimWrite( U_INT32_OR_64 addr, u_int32 width, u_int32 val )
+{
+	SIM_REG	*reg = _reg( addr );
+	u_int32	i, l;
+
+	G_stat.writes++;
+	G_stat.nowNs += G_accessNs;
+
+	if( reg == NULL )
+		return;
+
+	reg->val = val & _mask( width );
+
+	for( i=0; i<G_nDev; i++ )
+		for( l=ID_SIM_CS; l<=ID_SIM_DI; l++ )
+			if( G_dev[i].reg[l] == reg ){
+				_edge( &G_dev[i] );
+				break;
+			}
+}
+
+/******************************* ID_SimDelay *******************************/
+/**   Delay: advance the virtual time.
+ *
+ *---------------------------------------------------------------------------
+ *  \param ns			\IN time to wait [ns]
+ *
+ ****************************************************************************/
+void ID_SimDelay( u_int32 ns )
+{
+	G_stat.delays++;
+	G_stat.delayNs += ns;
+	G_stat.nowNs   += ns;
+}
+
+/*----------------------------------------------------------------------
+ * OSS FUNCTIONS OF THE HOST PROCESS
+ *--------------------------------------------------------------------*/
+
+int32 OSS_Delay( OSS_HANDLE *osHdl, int32 msec )
+{
+	(void)osHdl;
+
+	G_stat.sleeps++;
+	G_stat.sleepNs += (u_int64)msec * 1000000;
+	G_stat.nowNs   += (u_int64)msec * 1000000;
+	return msec;
+}
+
+u_int32 OSS_TickGet( OSS_HANDLE *osHdl )
+{
+	(void)osHdl;
+	return (u_int32)(G_stat.nowNs / 1000000);	/* 1 tick = 1ms */
+}
+
+int32 OSS_TickRateGet( OSS_HANDLE *osHdl )
+{
+	(void)osHdl;
+	return 1000;
+}
+
+void *OSS_MemGet( OSS_HANDLE *osHdl, u_int32 size, u_int32 *gotsizeP )
+{
+	void *mem = malloc( size );
+
+	(void)osHdl;
+	*gotsizeP = mem ? size : 0;
+	return mem;
+}
+
+int32 OSS_MemFree( OSS_HANDLE *osHdl, void *addr, u_int32 size )
+{
+	(void)osHdl;
+	(void)size;
+
+	free( addr );
+	return 0;
+}
+
+void OSS_MemFill( OSS_HANDLE *osHdl, u_int32 size, char *adr, int8 value )
+{
+	(void)osHdl;
+	memset( adr, value, size );
+}
+
+struct OSS_SEM_HANDLE
+{
+	int32	count;
+};
+
+int32 OSS_SemCreate( OSS_HANDLE *osHdl, int32 semType, int32 initVal,
+					 OSS_SEM_HANDLE **semP )
+{
+	(void)osHdl;
+	(void)semType;
+
+	if( (*semP = (OSS_SEM_HANDLE*)malloc( sizeof(**semP) )) == NULL )
+		return 1;
+
+	(*semP)->count = initVal;
+	return 0;
+}
+
+int32 OSS_SemRemove( OSS_HANDLE *osHdl, OSS_SEM_HANDLE **semP )
+{
+	(void)osHdl;
+	free( *semP );
+	*semP = NULL;
+	return 0;
+}
+
+int32 OSS_SemWait( OSS_HANDLE *osHdl, OSS_SEM_HANDLE *sem, int32 msec )
+{
+	(void)osHdl;
+	(void)msec;
+
+	if( sem->count <= 0 ){				/* would block forever */
+		G_stat.lockWaits++;
+		return 1;
+	}
+	sem->count--;
+	return 0;
+}
+
+int32 OSS_SemSignal( OSS_HANDLE *osHdl, OSS_SEM_HANDLE *sem )
+{
+	(void)osHdl;
+	sem->count++;
+	return 0;
+}
+
+/*----------------------------------------------------------------------
+ * DEVICE MODELS
+ *--------------------------------------------------------------------*/
+
+/******************************* _reg **************************************/
+/**   Find register, create it on first access
+ *---------------------------------------------------------------------------
+ *  \param addr			\IN register address
+ *  \return   register or NULL if table full
+ *
+ ***************************************************************************/
+static SIM_REG *_reg( U_INT32_OR_64 addr )
+{
+	u_int32 i;
+
+	for( i=0; i<G_nReg; i++ )
+		if( G_reg[i].addr == addr )
+			return &G_reg[i];
+
+	if( G_nReg >= ID_SIM_REG_MAX )
+		return NULL;
+
+	G_reg[G_nReg].addr = addr;
+	G_reg[G_nReg].val  = 0;
+	return &G_reg[G_nReg++];
+}
+
+/******************************* _mask *************************************/
+/**   Value mask of access width
+ ***************************************************************************/
+static u_int32 _mask( u_int32 width )
+{
+	return width >= 32 ? 0xffffffff : ((1UL << width) - 1);
+}
+
+/******************************* _busy *************************************/
+/**   Check programming cycle
+ ***************************************************************************/
+static int _busy( SIM_DEV *dev )
+{
+	return G_stat.nowNs < dev->busyUntil;
+}
+
+/******************************* _edge *************************************/
+/**   Get new line levels after register write and run device model.
+ *
+ *    A clock edge in the same write as a data change counts as clock
+ *    edge only: falling clock before, rising clock after the data
+ *    change. Start/stop conditions need the clock high before and after.
+ *
+ *---------------------------------------------------------------------------
+ *  \param dev			\IN device
+ *
+ ***************************************************************************/
+static void _edge( SIM_DEV *dev )
+{
+	u_int32 old = dev->level;
+	u_int32 l, new = 0;
+
+	for( l=ID_SIM_CS; l<=ID_SIM_DI; l++ )
+		if( dev->reg[l]->val & dev->cfg.line[l].mask )
+			new |= 1 << l;
+
+	if( new == old )
+		return;
+	dev->level = new;
+
+	if( (new & L_CS) && ((old ^ new) & L_SK) ){	/* check clock timing */
+		if( G_stat.nowNs - dev->lastEdge < dev->cfg.minHalfNs )
+			G_stat.timingErrs++;
+		dev->lastEdge = G_stat.nowNs;
+	}
+
+	if( dev->cfg.type == ID_SIM_93C )
+		_mwedge( dev, old, new );
+	else
+		_usmedge( dev, old, new );
+}
+
+/******************************* _mwedge ***********************************/
+/**   93Cxx: line change
+ *
+ *    CS low resets the device and starts a pending programming cycle.
+ *    DI is sampled with the rising edge of SK.
+ *
+ *---------------------------------------------------------------------------
+ *  \param dev			\IN device
+ *  \param old			\IN previous line levels
+ *  \param new			\IN current line levels
+ *
+ ***************************************************************************/
+static void _mwedge( SIM_DEV *dev, u_int32 old, u_int32 new )
+{
+	if( !(new & L_CS) ){
+		if( dev->pend )
+			_mwprog( dev );
+		dev->state = MW_S_START;
+		dev->out   = 1;						/* DO high-Z */
+		return;
+	}
+
+	if( !(old & L_CS) ){					/* selected */
+		dev->state    = MW_S_START;
+		dev->lastEdge = G_stat.nowNs;
+	}
+
+	if( !(old & L_SK) && (new & L_SK) )
+		_mwclock( dev, (new & L_DI) != 0 );
+}
+
+/******************************* _mwclock **********************************/
+/**   93Cxx: rising edge of SK
+ *
+ *    The dummy zero of READ is output with the last address bit,
+ *    each following edge outputs the next data bit (sequential read).
+ *
+ *---------------------------------------------------------------------------
+ *  \param dev			\IN device
+ *  \param di			\IN level of DI
+ *
+ ***************************************************************************/
+static void _mwclock( SIM_DEV *dev, u_int32 di )
+{
+	switch( dev->state ){
+	case MW_S_START:
+		if( !di )							/* leading zeros */
+			break;
+		if( _busy( dev ) ){					/* instruction ignored */
+			G_stat.nacks++;
+			dev->state = MW_S_IGNORE;
+			break;
+		}
+		dev->state = MW_S_CMD;
+		dev->bits  = 0;
+		dev->shift = 0;
+		dev->out   = 1;
+		break;
+	case MW_S_CMD:
+		dev->shift = (dev->shift << 1) | di;
+		if( ++dev->bits == 2 + dev->cfg.addrLength )
+			_mwexec( dev );
+		break;
+	case MW_S_DATA:
+		dev->shift = (dev->shift << 1) | di;
+		if( ++dev->bits == 16 ){
+			dev->pend  = dev->op;
+			dev->state = MW_S_IGNORE;
+		}
+		break;
+	case MW_S_READ:
+		dev->out = (dev->word[dev->addr] >> (15 - dev->bits)) & 0x01;
+		if( ++dev->bits == 16 ){
+			dev->bits = 0;
+			dev->addr = (dev->addr + 1) % dev->cfg.size;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/******************************* _mwexec ***********************************/
+/**   93Cxx: decode instruction after the last address bit
+ *---------------------------------------------------------------------------
+ *  \param dev			\IN device
+ *
+ ***************************************************************************/
+static void _mwexec( SIM_DEV *dev )
+{
+	u_int32 alen = dev->cfg.addrLength;
+	u_int32 addr = dev->shift & ((1UL << alen) - 1);
+	u_int32 op   = (dev->shift >> alen) & 0x3;
+
+	dev->addr  = addr % dev->cfg.size;
+	dev->bits  = 0;
+	dev->shift = 0;
+	dev->state = MW_S_IGNORE;
+
+	switch( op ){
+	case MW_READ:
+		dev->state = MW_S_READ;
+		dev->out   = 0;						/* dummy zero */
+		break;
+	case MW_WRITE:
+		dev->op    = MW_WRITE;
+		dev->state = MW_S_DATA;
+		break;
+	case MW_ERASE:
+		dev->pend  = MW_ERASE;
+		break;
+	default:								/* MW_EXT */
+		switch( addr >> (alen - 2) ){
+		case MW_EWEN:	dev->ewen = 1;				break;
+		case MW_EWDS:	dev->ewen = 0;				break;
+		case MW_ERAL:	dev->pend = MW_OP_ERAL;		break;
+		default:
+			dev->op    = MW_OP_WRAL;
+			dev->state = MW_S_DATA;
+			break;
+		}
+	}
+}
+
+/******************************* _mwprog ***********************************/
+/**   93Cxx: run pending programming cycle (CS low)
+ *---------------------------------------------------------------------------
+ *  \param dev			\IN device
+ *
+ ***************************************************************************/
+static void _mwprog( SIM_DEV *dev )
+{
+	u_int32 pend = dev->pend;
+	u_int32 i;
+
+	dev->pend = 0;
+	if( !dev->ewen ){						/* write disabled */
+		G_stat.nacks++;
+		return;
+	}
+
+	switch( pend ){
+	case MW_WRITE:
+		dev->word[dev->addr] = (u_int16)dev->shift;
+		break;
+	case MW_ERASE:
+		dev->word[dev->addr] = ID_ERASED_WORD;
+		break;
+	case MW_OP_ERAL:
+	case MW_OP_WRAL:
+		for( i=0; i<dev->cfg.size; i++ )
+			dev->word[i] = (u_int16)(pend == MW_OP_ERAL ?
+									 ID_ERASED_WORD : dev->shift);
+		break;
+	}
+
+	dev->busyUntil = G_stat.nowNs + dev->cfg.progNs;
+	G_stat.progCycles++;
+}
+
+/******************************* _usmedge **********************************/
+/**   USM: line change
+ *
+ *    B_SEL low resets the device and discards an unfinished page.
+ *    SDA falling/rising while SCL is high is a start/stop condition.
+ *
+ *---------------------------------------------------------------------------
+ *  \param dev			\IN device
+ *  \param old			\IN previous line levels
+ *  \param new			\IN current line levels
+ *
+ ***************************************************************************/
+static void _usmedge( SIM_DEV *dev, u_int32 old, u_int32 new )
+{
+	if( !(new & L_CS) || !(old & L_CS) ){	/* (de)selected */
+		memset( dev->pflag, 0, dev->cfg.size );
+		dev->pend  = 0;
+		dev->state = U_S_IDLE;
+		dev->out   = 1;
+		dev->lastEdge = G_stat.nowNs;
+		return;
+	}
+
+	if( (old ^ new) & L_SK ){
+		if( new & L_SK )
+			_usmrise( dev, (new & L_DI) != 0 );
+		else
+			_usmfall( dev );
+	}
+	else if( new & L_SK ){
+		if( !(new & L_DI) ){				/* start condition */
+			memset( dev->pflag, 0, dev->cfg.size );
+			dev->pend  = 0;
+			dev->state = U_S_RX;
+			dev->what  = U_B_DEVADDR;
+			dev->bits  = 0;
+			dev->shift = 0;
+			dev->out   = 1;
+		}
+		else								/* stop condition */
+			_usmstop( dev );
+	}
+}
+
+/******************************* _usmrise **********************************/
+/**   USM: rising edge of SCL, sample SDA
+ *---------------------------------------------------------------------------
+ *  \param dev			\IN device
+ *  \param di			\IN SDA level of master
+ *
+ ***************************************************************************/
+static void _usmrise( SIM_DEV *dev, u_int32 di )
+{
+	switch( dev->state ){
+	case U_S_RX:
+		if( dev->bits < 8 ){
+			dev->shift = ((dev->shift << 1) | di) & 0xff;
+			if( ++dev->bits == 8 )
+				_usmbyte( dev );
+		}
+		else
+			dev->bits = 9;					/* acknowledge clocked */
+		break;
+	case U_S_TX:
+		if( dev->bits < 8 )
+			dev->bits++;
+		else {
+			dev->ack  = !di;				/* master acknowledge */
+			dev->bits = 9;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/******************************* _usmfall **********************************/
+/**   USM: falling edge of SCL, device changes SDA
+ *---------------------------------------------------------------------------
+ *  \param dev			\IN device
+ *
+ ***************************************************************************/
+static void _usmfall( SIM_DEV *dev )
+{
+	switch( dev->state ){
+	case U_S_RX:
+		if( dev->bits == 8 )				/* acknowledge */
+			dev->out = !dev->ack;
+		else if( dev->bits == 9 ){
+			dev->out   = 1;
+			dev->bits  = 0;
+			dev->shift = 0;
+			dev->state = dev->ack ? dev->next : U_S_IDLE;
+			if( dev->state == U_S_TX ){
+				dev->shift = dev->byte[dev->addr];
+				dev->addr  = (dev->addr + 1) % dev->cfg.size;
+				dev->out   = (dev->shift >> 7) & 0x01;
+			}
+		}
+		break;
+	case U_S_TX:
+		if( dev->bits < 8 )
+			dev->out = (dev->shift >> (7 - dev->bits)) & 0x01;
+		else if( dev->bits == 8 )
+			dev->out = 1;					/* release for acknowledge */
+		else if( dev->ack ){				/* next byte */
+			dev->shift = dev->byte[dev->addr];
+			dev->addr  = (dev->addr + 1) % dev->cfg.size;
+			dev->bits  = 0;
+			dev->out   = (dev->shift >> 7) & 0x01;
+		}
+		else {								/* no acknowledge: done */
+			dev->state = U_S_IDLE;
+			dev->out   = 1;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/******************************* _usmbyte **********************************/
+/**   USM: byte received, decide acknowledge
+ *
+ *    While busy the device address is not acknowledged. Data bytes go
+ *    to the page buffer, the address rolls over within the page.
+ *
+ *---------------------------------------------------------------------------
+ *  \param dev			\IN device
+ *
+ ***************************************************************************/
+static void _usmbyte( SIM_DEV *dev )
+{
+	u_int32 page = dev->cfg.pageSize;
+
+	dev->ack  = 1;
+	dev->next = U_S_RX;
+
+	switch( dev->what ){
+	case U_B_DEVADDR:
+		if( (dev->shift & 0xfe) != USM_DEVADDR || _busy( dev ) ){
+			G_stat.nacks++;
+			dev->ack = 0;
+		}
+		else if( dev->shift & 0x01 )
+			dev->next = U_S_TX;				/* read */
+		else
+			dev->what = U_B_WORDADDR;
+		break;
+	case U_B_WORDADDR:
+		dev->addr = dev->shift % dev->cfg.size;
+		dev->what = U_B_DATA;
+		break;
+	default:
+		dev->page[dev->addr]  = (u_int8)dev->shift;
+		dev->pflag[dev->addr] = 1;
+		dev->pend++;
+		dev->addr = (dev->addr & ~(page - 1)) | ((dev->addr + 1) & (page - 1));
+		break;
+	}
+}
+
+/******************************* _usmstop **********************************/
+/**   USM: stop condition, start write cycle of received bytes
+ *---------------------------------------------------------------------------
+ *  \param dev			\IN device
+ *
+ ***************************************************************************/
+static void _usmstop( SIM_DEV *dev )
+{
+	u_int32 i;
+
+	if( dev->pend ){
+		for( i=0; i<dev->cfg.size; i++ )
+			if( dev->pflag[i] ){
+				dev->byte[i]  = dev->page[i];
+				dev->pflag[i] = 0;
+			}
+		dev->pend      = 0;
+		dev->busyUntil = G_stat.nowNs + dev->cfg.progNs;
+		G_stat.progCycles++;
+	}
+
+	dev->state = U_S_IDLE;
+	dev->out   = 1;
+}
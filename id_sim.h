@@ -0,0 +1,124 @@
+/***********************  I n c l u d e  -  F i l e  ************************
+ *
+ *         Name: id_sim.h
+ *
+ *       Author: kp
+ *
+ *  Description: Simulated EEPROM backend of the ID library (variant id_sim)
+ *
+ *               In the ID_SIM variant all register accesses (MREAD_Dx,
+ *               MWRITE_Dx) and all delays of the library are routed to
+ *               software models of the 93Cxx Microwire EEPROM and of the
+ *               USM two-wire EEPROM. Time is virtual, so the library runs
+ *               as an ordinary host process (see id_sim.c).
+ *
+ *     Switches: ID_SIM
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 1999-2019, MEN Mikro Elektronik GmbH
+ ******************************************************************************/
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _ID_SIM_H
+#define _ID_SIM_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define ID_SIM_DEV_MAX		16		/* max. number of simulated devices */
+#define ID_SIM_REG_MAX		32		/* max. number of simulated registers */
+
+/*--- ID_SIM_DEV.type ---*/
+#define ID_SIM_93C			1		/* 93Cxx Microwire EEPROM, x16 */
+#define ID_SIM_USM			2		/* USM two-wire EEPROM */
+
+/*--- ID_SIM_DEV.line[] ---*/
+#define ID_SIM_CS			0		/* chip select (USM: B_SEL) */
+#define ID_SIM_SK			1		/* clock (USM: SCL) */
+#define ID_SIM_DI			2		/* data in (USM: SDA) */
+#define ID_SIM_DO			3		/* data out (USM: SDA, same as DI) */
+#define ID_SIM_LINES		4
+
+/*--- model defaults ---*/
+#define ID_SIM_93C_T_WP_NS	2000000	/* 93Cxx programming time */
+#define ID_SIM_93C_T_SK_NS	250		/* 93Cxx min. SK high/low time */
+#define ID_SIM_USM_T_WR_NS	5000000	/* USM write cycle time */
+#define ID_SIM_USM_T_SCL_NS	4000	/* USM min. SCL high/low time */
+#define ID_SIM_USM_BYTES	256		/* USM EEPROM size */
+#define ID_SIM_USM_PAGE		8		/* USM page size [bytes] */
+
+/*--------------------------------------+
+|   TYPDEFS                             |
++--------------------------------------*/
+/** one line of a simulated device */
+typedef struct
+{
+	U_INT32_OR_64	addr;		/**< register address (base + offset) */
+	u_int32			mask;		/**< bit in register, high active */
+} ID_SIM_LINE;
+
+/** simulated device configuration (see ID_SimAttach()) */
+typedef struct
+{
+	u_int32			type;		/**< ID_SIM_93C or ID_SIM_USM */
+	ID_SIM_LINE		line[ID_SIM_LINES];	/**< CS, SK, DI, DO */
+	u_int32			addrLength;	/**< 93C: address bits (6 = 93C46) */
+	u_int32			size;		/**< 93C: words, USM: bytes */
+	u_int32			pageSize;	/**< USM: page size [bytes] */
+	u_int32			progNs;		/**< programming/write cycle time */
+	u_int32			minHalfNs;	/**< min. clock high/low time */
+} ID_SIM_DEV;
+
+/** simulation counters (see ID_SimStatGet()) */
+typedef struct
+{
+	u_int64			nowNs;		/**< virtual time */
+	u_int32			reads;		/**< register reads */
+	u_int32			writes;		/**< register writes */
+	u_int32			delays;		/**< ID_DelayNs() calls */
+	u_int64			delayNs;	/**< time spent in ID_DelayNs() */
+	u_int32			sleeps;		/**< OSS_Delay() calls */
+	u_int64			sleepNs;	/**< time spent in OSS_Delay() */
+	u_int32			progCycles;	/**< programming cycles started */
+	u_int32			busyReads;	/**< reads while a device was busy */
+	u_int32			nacks;		/**< commands ignored/not acknowledged */
+	u_int32			timingErrs;	/**< clock high/low time too short */
+	u_int32			lockWaits;	/**< semaphore waits that would block */
+} ID_SIM_STAT;
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+extern void  ID_SimInit( u_int32 accessNs );
+extern int32 ID_SimAttach( const ID_SIM_DEV *devP );
+extern int32 ID_SimAttachModule( U_INT32_OR_64 base );
+extern int32 ID_SimAttachUsm( U_INT32_OR_64 base );
+extern int32 ID_SimLoad( int32 dev, const u_int16 *buf, u_int32 words );
+extern int32 ID_SimDump( int32 dev, u_int16 *buf, u_int32 words );
+extern int   ID_SimBusy( int32 dev );
+extern void  ID_SimIdle( void );
+extern void  ID_SimStatGet( ID_SIM_STAT *statP );
+extern void  ID_SimStatReset( void );
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif	/* _ID_SIM_H */
@@ -0,0 +1,469 @@
+/*********************  P r o g r a m  -  M o d u l e **********************/
+/*!
+ *         \file id_time.c
+ *      Project: ID LIB
+ *
+ *       \author kp
+ *
+ *        \brief Calibrated bit timing for the bit-bang EEPROM protocols
+ *
+ *               The busy-wait loop is calibrated once against the OS tick
+ *               (explicitly via ID_TimeInit(), by MCRW_PORT_Init() or
+ *               before the first M-Module/USM transaction takes its lock).
+ *               Afterwards ID_DelayNs() waits the requested time
+ *               independent of CPU speed and compiler. Until then, or if
+ *               the tick is not usable, a conservative loop count is used
+ *               that is too high for any supported CPU, so the bus runs
+ *               slower but never faster than the datasheet allows.
+ *
+ *               ID_WaitStart()/ID_WaitNext() implement the deadline
+ *               based ready polling of the EEPROM programming cycle.
+ *
+ *     Required: oss
+ *     Switches: ID_SIM - delays advance the virtual time of the
+ *                        simulated backend (see id_sim.c)
+ */
+ /*---------------------------[ Public Functions ]----------------------------
+ *
+ * int32 ID_TimeInit(osHdl)          calibrate busy-wait loop
+ * void  ID_TimeInfo(infoP)          get calibration result
+ * void  ID_PollConfigSet(pollP)     set default ready polling config
+ * void  ID_PollConfigGet(pollP)     get default ready polling config
+ * void  ID_DelayNs(ns)              busy-wait (library internal)
+ * void  ID_WaitStart(osHdl,poll,    start ready polling (library internal)
+ *                    waitP)
+ * int   ID_WaitNext(waitP)          back-off/deadline (library internal)
+ * void  ID_PollStart(job,poll)      start non-blocking ready polling
+ *                                   (library internal)
+ * int   ID_PollExpired(job)         check deadline (library internal)
+ * void  ID_TimeCheck(osHdl)         calibrate unless done (library internal)
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 1999-2019, MEN Mikro Elektronik GmbH
+ ******************************************************************************/
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "id_var.h"
+#include <MEN/men_typs.h>
+#include <MEN/dbg.h>
+#include <MEN/oss.h>
+#include "id_ext.h"
+#include "id_int.h"
+
+/*-----------------------------------------+
+|  DEFINES & CONST                         |
++-----------------------------------------*/
+#define CAL_ROUNDS		3		/* calibration rounds (fastest is used) */
+#define CAL_TIME_MS		20		/* calibration period per round */
+#define CAL_MIN_TICKS	2		/* min. calibration period in ticks */
+#define CAL_CHUNK		10000	/* loops between two tick reads */
+#define CAL_MARGIN		16		/* add 1/16 safety margin */
+#define CAL_FALLBACK	2000000	/* loops/ms without calibration (>= any CPU) */
+#define CAL_MAX_MS		2000	/* max. tick wait at fallback speed
+								   (CAL_MAX_MS * CAL_FALLBACK < 2^32) */
+
+/* state of the calibration (G_calState) */
+#define CAL_NONE		0		/* not yet tried */
+#define CAL_DONE		1		/* calibrated */
+#define CAL_FAILED		2		/* no usable tick, fallback used */
+
+/*-----------------------------------------+
+|  STATICS                                 |
++-----------------------------------------*/
+static u_int32 G_loopsPerMs = CAL_FALLBACK;
+static u_int32 G_loopsPerUsQ10 = (CAL_FALLBACK / 1000) * 1024;	/* loops per
+																   us * 1024 */
+static u_int32 G_calState;		/* CAL_xxx */
+
+static ID_POLL G_poll = {		/* default ready polling */
+	ID_POLL_TIMEOUT_US,
+	ID_POLL_MIN_US,
+	ID_POLL_MAX_US,
+	0
+};
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+#ifndef ID_SIM
+static void _spin( u_int32 loops );
+static u_int32 _tickwait( OSS_HANDLE *osHdl, u_int32 start, u_int32 n,
+						  u_int32 chunk, u_int32 maxLoops );
+#endif
+static u_int32 _deadline( u_int32 timeoutUs, u_int32 rate );
+
+/******************************* ID_TimeInit *******************************/
+/**   Calibrate the busy-wait loop against the OS tick.
+ *
+ *    Spins three times for about 20ms (at least two ticks) and measures
+ *    the number of loops. The fastest round is used, so that a round
+ *    disturbed by interrupts or preemption cannot shorten the delays.
+ *    Calling the function again repeats the calibration.
+ *    Should be called at driver init. If never called, the calibration
+ *    is done by MCRW_PORT_Init() or before the first transaction of the
+ *    m_xxx/usm_xxx functions takes its lock, with a NULL OSS handle.
+ *
+ *    Waiting for the tick is bounded: if the tick rate is invalid or
+ *    the tick does not advance in the caller's context, the
+ *    conservative fallback loop count (CAL_FALLBACK) is used instead.
+ *
+ *---------------------------------------------------------------------------
+ *  \param osHdl		\IN OSS handle (may be NULL)
+ *  \return   0=ok, 1=error (no usable tick, fallback used)
+ *
+ ****************************************************************************/
+int32 ID_TimeInit( OSS_HANDLE *osHdl )
+{
+#ifdef ID_SIM
+	/* virtual time: nothing to calibrate */
+	(void)osHdl;
+
+	G_loopsPerUsQ10 = 1024;
+	G_loopsPerMs    = 1000;
+	G_calState      = CAL_DONE;
+
+	return 0;
+#else
+	int32	rate;
+	u_int32	nTicks, start, ticks, loops, loopsPerTick, loopsPerMs = 0;
+	u_int32	maxMs;
+	int		round;
+
+	rate = OSS_TickRateGet( osHdl );
+	if( rate <= 0 )
+		goto FALLBACK;
+
+	nTicks = ((u_int32)rate * CAL_TIME_MS) / 1000;
+	if( nTicks < CAL_MIN_TICKS )
+		nTicks = CAL_MIN_TICKS;
+
+	/* bound of one tick wait: the calibration period plus one tick
+	   at the (highest) fallback speed */
+	maxMs = ((nTicks + 1) * 1000) / (u_int32)rate + 1;
+	if( maxMs > CAL_MAX_MS )
+		maxMs = CAL_MAX_MS;
+
+	for( round=0; round<CAL_ROUNDS; round++ ){
+		/* synchronize to tick edge */
+		start = OSS_TickGet( osHdl );
+		if( !_tickwait( osHdl, start, 1, 1, maxMs * CAL_FALLBACK ) )
+			goto FALLBACK;
+		start = OSS_TickGet( osHdl );
+
+		/* spin until calibration period elapsed */
+		if( !(loops = _tickwait( osHdl, start, nTicks, CAL_CHUNK,
+								 maxMs * CAL_FALLBACK )) )
+			goto FALLBACK;
+		ticks = OSS_TickGet( osHdl ) - start;
+
+		loopsPerTick = loops / ticks;
+		loops = (loopsPerTick / 1000) * (u_int32)rate
+			+ ((loopsPerTick % 1000) * (u_int32)rate) / 1000;
+		if( loops > loopsPerMs )
+			loopsPerMs = loops;
+	}
+
+	loopsPerMs += loopsPerMs / CAL_MARGIN;
+	if( loopsPerMs < 1000 )
+		loopsPerMs = 1000;
+
+	G_loopsPerUsQ10 = (loopsPerMs / 1000) * 1024
+		+ ((loopsPerMs % 1000) * 1024) / 1000;
+	G_loopsPerMs    = loopsPerMs;
+	G_calState      = CAL_DONE;
+
+	return 0;
+
+FALLBACK:
+	G_loopsPerUsQ10 = (CAL_FALLBACK / 1000) * 1024;
+	G_loopsPerMs    = CAL_FALLBACK;
+	G_calState      = CAL_FAILED;
+
+	return 1;
+#endif
+}
+
+/******************************* ID_TimeCheck ******************************/
+/**   Calibrate the busy-wait loop unless already done or failed.
+ *
+ *    Called at the start of a transaction before any lock is taken,
+ *    never from within a transaction.
+ *
+ *---------------------------------------------------------------------------
+ *  \param osHdl		\IN OSS handle (may be NULL)
+ *
+ ****************************************************************************/
+void ID_TimeCheck( OSS_HANDLE *osHdl )
+{
+	if( G_calState == CAL_NONE )
+		ID_TimeInit( osHdl );
+}
+
+/******************************* ID_TimeInfo *******************************/
+/**   Get the calibration result and the resulting bus clocks.
+ *
+ *    The Microwire clock is one bit per two half periods, the USM
+ *    clock one bit per three delays (see usmrw.c _clock()).
+ *    Bus access time is not included.
+ *
+ *---------------------------------------------------------------------------
+ *  \param infoP		\OUT calibration info
+ *
+ ****************************************************************************/
+void ID_TimeInfo( ID_TIME_INFO *infoP )
+{
+	ID_TimeCheck( NULL );
+
+	infoP->loopsPerMs	= G_loopsPerMs;
+	infoP->mwHalfNs		= ID_T_MW_HALF_NS;
+	infoP->mwClockHz	= 1000000000 / (2 * ID_T_MW_HALF_NS);
+	infoP->usmHalfNs	= ID_T_USM_HALF_NS;
+	infoP->usmClockHz	= 1000000000 / (3 * ID_T_USM_HALF_NS);
+}
+
+/******************************* ID_PollConfigSet **************************/
+/**   Set the default ready polling configuration.
+ *
+ *    Used by the m_xxx functions and as initial value of new
+ *    MCRW handles.
+ *
+ *---------------------------------------------------------------------------
+ *  \param pollP		\IN polling configuration
+ *
+ ****************************************************************************/
+void ID_PollConfigSet( const ID_POLL *pollP )
+{
+	G_poll = *pollP;
+}
+
+/******************************* ID_PollConfigGet **************************/
+/**   Get the default ready polling configuration.
+ *
+ *---------------------------------------------------------------------------
+ *  \param pollP		\OUT polling configuration
+ *
+ ****************************************************************************/
+void ID_PollConfigGet( ID_POLL *pollP )
+{
+	*pollP = G_poll;
+}
+
+/******************************* ID_WaitStart ******************************/
+/**   Start ready polling, set the deadline.
+ *
+ *    The deadline is the timeout rounded up to full ticks plus one tick
+ *    for the partial tick at start.
+ *
+ *---------------------------------------------------------------------------
+ *  \param osHdl		\IN OSS handle (may be NULL)
+ *  \param poll			\IN polling configuration (NULL=default)
+ *  \param waitP		\OUT polling state
+ *
+ ****************************************************************************/
+void ID_WaitStart( OSS_HANDLE *osHdl, const ID_POLL *poll, ID_WAIT *waitP )
+{
+	u_int32 rate = (u_int32)OSS_TickRateGet( osHdl );
+
+	if( poll == NULL )
+		poll = &G_poll;
+
+	waitP->osHdl	 = osHdl;
+	waitP->poll		 = poll;
+	waitP->ticks	 = _deadline( poll->timeoutUs, rate );
+	waitP->backoffUs = poll->minUs ? poll->minUs : 1;
+	waitP->waitedUs	 = 0;
+	waitP->count	 = 0;
+	waitP->start	 = OSS_TickGet( osHdl );
+}
+
+/******************************* ID_WaitNext *******************************/
+/**   Check deadline and wait the current back-off time.
+ *
+ *    The caller samples the ready state before each call. The polling
+ *    times out when the deadline tick has been reached or the
+ *    accumulated back-off alone exceeds the timeout (the tick may not
+ *    advance in all contexts).
+ *
+ *    With ID_POLL_SLEEP, back-offs of 1ms and more sleep instead of
+ *    spinning. The back-off is limited to poll->maxUs, so the flag has
+ *    no effect unless maxUs is at least 1000 (default ID_POLL_MAX_US
+ *    is 500).
+ *
+ *---------------------------------------------------------------------------
+ *  \param waitP		\INOUT polling state
+ *  \return   0=continue polling, 1=timeout
+ *
+ ****************************************************************************/
+int ID_WaitNext( ID_WAIT *waitP )
+{
+	const ID_POLL *poll = waitP->poll;
+
+	if( waitP->waitedUs >= poll->timeoutUs
+		|| (OSS_TickGet( waitP->osHdl ) - waitP->start) >= waitP->ticks )
+		return 1;
+
+	if( (poll->flags & ID_POLL_SLEEP) && waitP->backoffUs >= 1000 )
+		OSS_Delay( waitP->osHdl, (int32)(waitP->backoffUs / 1000) );
+	else
+		ID_DelayNs( waitP->backoffUs * 1000 );
+
+	waitP->waitedUs += waitP->backoffUs;
+	waitP->count++;
+
+	/* double back-off up to max */
+	waitP->backoffUs *= 2;
+	if( waitP->backoffUs > poll->maxUs )
+		waitP->backoffUs = poll->maxUs ? poll->maxUs : 1;
+
+	return 0;
+}
+
+/******************************* ID_PollStart ******************************/
+/**   Start non-blocking ready polling of a write job, set the deadline.
+ *
+ *    Same deadline as ID_WaitStart(). The back-off is not waited but
+ *    returned to the caller as suggested time until the next step.
+ *
+ *---------------------------------------------------------------------------
+ *  \param job			\INOUT write job
+ *  \param poll			\IN polling configuration (NULL=default)
+ *
+ ****************************************************************************/
+void ID_PollStart( ID_AWRITE *job, const ID_POLL *poll )
+{
+	u_int32 rate = (u_int32)OSS_TickRateGet( job->osHdl );
+
+	if( poll == NULL )
+		poll = &G_poll;
+
+	job->ticks  = _deadline( poll->timeoutUs, rate );
+	job->pollUs = poll->minUs;
+	job->start  = OSS_TickGet( job->osHdl );
+}
+
+/******************************* ID_PollExpired ****************************/
+/**   Check deadline of non-blocking ready polling, count the poll.
+ *
+ *---------------------------------------------------------------------------
+ *  \param job			\INOUT write job
+ *  \return   0=continue polling, 1=timeout
+ *
+ ****************************************************************************/
+int ID_PollExpired( ID_AWRITE *job )
+{
+	job->polls++;
+
+	return (OSS_TickGet( job->osHdl ) - job->start) >= job->ticks;
+}
+
+/******************************* ID_DelayNs ********************************/
+/**   Busy-wait (at least) the specified time.
+ *
+ *    Never calibrates (may be called within a locked transaction), the
+ *    fallback loop count applies until ID_TimeCheck()/ID_TimeInit().
+ *
+ *---------------------------------------------------------------------------
+ *  \param ns			\IN time to wait [ns]
+ *
+ ****************************************************************************/
+void ID_DelayNs( u_int32 ns )
+{
+#ifdef ID_SIM
+	ID_SimDelay( ns );
+#else
+	while( ns >= 1000000 ){
+		_spin( G_loopsPerMs );
+		ns -= 1000000;
+	}
+
+	_spin( ((ns / 1000) * G_loopsPerUsQ10
+			+ ((ns % 1000) * G_loopsPerUsQ10) / 1000 + 1023) >> 10 );
+#endif
+}
+
+#ifndef ID_SIM
+/******************************* _spin *************************************/
+/**   Busy-wait loop
+ *---------------------------------------------------------------------------
+ *  \param loops		\IN number of loops
+ *
+ ***************************************************************************/
+static void _spin( u_int32 loops )
+{
+    register volatile u_int32 i;
+
+    for(i=loops; i>0; i--)
+        ;
+}
+
+/******************************* _tickwait *********************************/
+/**   Spin until the tick advanced by <n>, bounded
+ *
+ *    With a <chunk> of 1 the tick is read after each loop (tick edge
+ *    synchronization), reading the tick takes longer than a loop, so
+ *    the bound is not shorter in time.
+ *---------------------------------------------------------------------------
+ *  \param osHdl		\IN OSS handle (may be NULL)
+ *  \param start		\IN start tick
+ *  \param n			\IN ticks to wait
+ *  \param chunk		\IN loops between two tick reads
+ *  \param maxLoops		\IN give up after this number of loops
+ *  \return   loops spun or 0 if the tick did not advance in time
+ *
+ ***************************************************************************/
+static u_int32 _tickwait( OSS_HANDLE *osHdl, u_int32 start, u_int32 n,
+						  u_int32 chunk, u_int32 maxLoops )
+{
+	u_int32 loops = 0;
+
+	do {
+		if( loops >= maxLoops )
+			return 0;
+		_spin( chunk );
+		loops += chunk;
+	} while( OSS_TickGet( osHdl ) - start < n );
+
+	return loops;
+}
+#endif
+
+/******************************* _deadline *********************************/
+/**   Convert a timeout to ticks, rounded up, plus one tick for the
+ *    partial tick at start
+ *
+ *    The microseconds are rounded up, not truncated to milliseconds
+ *    first. Tick rates above 4294Hz would overflow the exact product,
+ *    there the remainder is rounded up to full milliseconds first
+ *    (never shorter).
+ *---------------------------------------------------------------------------
+ *  \param timeoutUs	\IN timeout [us]
+ *  \param rate			\IN tick rate [Hz]
+ *  \return   ticks until deadline
+ *
+ ***************************************************************************/
+static u_int32 _deadline( u_int32 timeoutUs, u_int32 rate )
+{
+	u_int32 rem = timeoutUs % 1000000;
+	u_int32 ticks = (timeoutUs / 1000000) * rate;
+
+	if( rate <= 0xffffffff / 1000000 )
+		ticks += (rem * rate + 999999) / 1000000;
+	else
+		ticks += (((rem + 999) / 1000) * rate + 999) / 1000;
+
+	return ticks + 1;
+}
@@ -0,0 +1,567 @@
+/*********************  P r o g r a m  -  M o d u l e **********************/
+/*!
+ *         \file id_util.c
+ *      Project: ID LIB
+ *
+ *       \author kp
+ *
+ *        \brief Protocol independent helpers of the ID library
+ *
+ *               The ID_BusXxx() functions access the bit-bang register
+ *               through a shadow of the last written value. Writes that
+ *               would not change any line are elided and all accesses
+ *               are counted per transaction.
+ *
+ *               After ID_LockInit() each transaction holds a lock of
+ *               its register. The locks are a table of semaphores
+ *               indexed by a hash of the register address, so
+ *               transactions on different modules do not share a lock.
+ *               Data shared by all modules (counters, id-prom cache) has
+ *               its own short-held lock (ID_LockAux()), always taken
+ *               after the register locks.
+ *
+ *     Required: none
+ *     Switches: none
+ */
+ /*---------------------------[ Public Functions ]----------------------------
+ *
+ * void ID_BusStatGet(statP)         get register access counters
+ * void ID_BusStatReset()            clear register access counters
+ * int32 ID_LockInit(osHdl)          create per register lock table
+ * void ID_LockExit()                remove lock table
+ * int  ID_WriteStep(job)            advance non-blocking write
+ * u_int32 ID_WriteRun(jobs,n)       run non-blocking writes round-robin
+ * u_int16 ID_FillValue(buf,count,  best fill value for bulk programming
+ *                       flags)      (library internal)
+ * void ID_BusOpen(bus,base,reg)     start transaction (library internal)
+ * void ID_BusOpenX(bus,base,reg,    start transaction, 8/16/32 bit
+ *                  width)           (library internal)
+ * void ID_BusClose(bus)             end transaction (library internal)
+ * void ID_BusWrite(bus,val)         shadowed write (library internal)
+ * u_int32 ID_BusRead(bus)           counted read (library internal)
+ * u_int32 ID_LockMask(addr)         lock of a register (library internal)
+ * void ID_Lock(mask)                acquire locks (library internal)
+ * void ID_Unlock(mask)              release locks (library internal)
+ * void ID_LockAux(n)                lock shared data (library internal)
+ * void ID_UnlockAux(n)              unlock shared data (library internal)
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 1999-2019, MEN Mikro Elektronik GmbH
+ ******************************************************************************/
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "id_var.h"
+#include <MEN/men_typs.h>
+#include <MEN/dbg.h>
+#include <MEN/oss.h>
+#include <MEN/maccess.h>
+#include "id_ext.h"
+#include "id_int.h"
+
+/*-----------------------------------------+
+|  STATICS                                 |
++-----------------------------------------*/
+static ID_BUS_STAT G_busStat;	/* register access counters */
+static OSS_HANDLE *G_lockOs;	/* OS handle of the lock table */
+static OSS_SEM_HANDLE *G_lockSem[ID_LOCK_SLOTS];	/* NULL: no locking */
+static OSS_SEM_HANDLE *G_auxSem[ID_AUX_LOCKS];		/* shared data locks */
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+static void    _wr8( ID_BUS *bus, u_int32 val );
+static void    _wr16( ID_BUS *bus, u_int32 val );
+static void    _wr32( ID_BUS *bus, u_int32 val );
+static u_int32 _rd8( ID_BUS *bus );
+static u_int32 _rd16( ID_BUS *bus );
+static u_int32 _rd32( ID_BUS *bus );
+
+/******************************* ID_WriteStep ******************************/
+/**   Advance a non-blocking write job.
+ *
+ *    The job is started with m_writestart(), usm_writestart() or
+ *    MCRW_PORT_WriteStart(). Each step samples the ready state of the
+ *    EEPROM once; when the programming cycle is finished, the next
+ *    word is shifted out and the step returns. A step never waits for
+ *    the programming cycle, so it may be called from a polling loop
+ *    of the caller or from a timer callback (<job->pollUs> is the
+ *    suggested time until the next step). Jobs on different devices
+ *    can be advanced alternately.
+ *
+ *---------------------------------------------------------------------------
+ *  \param job			\INOUT write job
+ *  \return   ID_AW_DONE, ID_AW_BUSY or ID_AW_ERROR (see job->error)
+ *
+ ****************************************************************************/
+int ID_WriteStep( ID_AWRITE *job )
+{
+	return job->step( job );
+}
+
+/******************************* ID_WriteRun *******************************/
+/**   Run several non-blocking write jobs until all have finished.
+ *
+ *    The jobs are stepped round-robin, so while one EEPROM is busy with
+ *    its programming cycle the next word is started on the others; the
+ *    total time approaches that of the slowest job instead of the sum.
+ *    When no job could start a new word in a round, the shortest
+ *    suggested back-off (job->pollUs) is waited before the next round.
+ *    Finished jobs are stepped again without bus access.
+ *
+ *---------------------------------------------------------------------------
+ *  \param jobs			\INOUT started write jobs
+ *  \param n			\IN number of jobs
+ *  \return   number of failed jobs (see job->error)
+ *
+ ****************************************************************************/
+u_int32 ID_WriteRun( ID_AWRITE *jobs, u_int32 n )
+{
+	u_int32 i, busy, failed, waitUs;
+	u_int32 polls;
+
+	do {
+		busy = failed = 0;
+		waitUs = 0;
+		polls = 0;
+
+		for( i=0; i<n; i++ ){
+			polls -= jobs[i].polls;
+
+			switch( ID_WriteStep( &jobs[i] ) ){
+			case ID_AW_BUSY:
+				if( busy++ == 0 || jobs[i].pollUs < waitUs )
+					waitUs = jobs[i].pollUs;
+				break;
+			case ID_AW_ERROR:
+				failed++;
+				break;
+			}
+
+			polls += jobs[i].polls;
+		}
+
+		/* back-off only if every busy job was just polled */
+		if( busy && polls == busy )
+			ID_DelayNs( (waitUs ? waitUs : 1) * 1000 );
+	} while( busy );
+
+	return failed;
+}
+
+/******************************* ID_FillValue ******************************/
+/**   Get the best fill value for bulk programming of an image.
+ *
+ *    After ERAL all words are 0xFFFF, so without WRAL the image costs
+ *    one programming cycle per word that is not 0xFFFF (N-nErased).
+ *    A WRAL with another value costs one cycle, and every word that
+ *    differs from the fill value then needs an explicit ERASE before
+ *    its WRITE, unless ID_WF_NOERASE is set: 1+k*(N-nCand) with k=2
+ *    (k=1 with ID_WF_NOERASE). WRAL is only chosen if it is cheaper.
+ *    The candidate is the most frequent value of the image (the count
+ *    is quadratic in the image size, negligible against one
+ *    programming cycle).
+ *
+ *---------------------------------------------------------------------------
+ *  \param buf			\IN image
+ *  \param count		\IN number of words in image
+ *  \param flags		\IN write flags (ID_WF_xxx)
+ *  \return   fill value (0xFFFF = no WRAL required)
+ *
+ ****************************************************************************/
+u_int16 ID_FillValue( const u_int16 *buf, u_int32 count, u_int32 flags )
+{
+	u_int32	i, j, n, nCand = 0, nErased = 0;
+	u_int32	k = (flags & ID_WF_NOERASE) ? 1 : 2;
+	u_int16	cand = ID_ERASED_WORD;
+
+	/* most frequent value, each value counted at its first occurrence */
+	for( i=0; i<count; i++ ){
+		for( j=0; j<i && buf[j] != buf[i]; j++ )
+			;
+		if( j < i )
+			continue;
+
+		for( n=0, j=i; j<count; j++ )
+			if( buf[j] == buf[i] )
+				n++;
+
+		if( buf[i] == ID_ERASED_WORD )
+			nErased = n;
+		else if( n > nCand ){
+			cand  = buf[i];
+			nCand = n;
+		}
+	}
+
+	if( nCand && 1 + k * (count - nCand) < count - nErased )
+		return cand;
+
+	return ID_ERASED_WORD;
+}
+
+/******************************* ID_BusOpen ********************************/
+/**   Start a transaction on a 16-bit bit-bang register.
+ *
+ *    The bit timing is calibrated here on first use (see ID_TimeCheck()),
+ *    before the lock is taken.
+ *    The shadow starts unknown, so the first write of a transaction is
+ *    always done. Other register users (e.g. other bits of a shared
+ *    port) may have changed the register between two transactions.
+ *
+ *---------------------------------------------------------------------------
+ *  \param bus			\OUT access context
+ *  \param base			\IN base address
+ *  \param reg			\IN register offset
+ *
+ ****************************************************************************/
+void ID_BusOpen( ID_BUS *bus, U_INT32_OR_64 base, u_int32 reg )
+{
+	ID_TimeCheck( NULL );
+	ID_BusOpenX( bus, base, reg, 16 );
+
+	bus->lock = ID_LockMask( base + reg );
+	ID_Lock( bus->lock );
+}
+
+/******************************* ID_BusOpenX *******************************/
+/**   Start a transaction on a bit-bang register of any access width.
+ *
+ *    The access function is selected here once, so the single accesses
+ *    do not depend on the width.
+ *
+ *---------------------------------------------------------------------------
+ *  \param bus			\OUT access context
+ *  \param base			\IN base address
+ *  \param reg			\IN register offset
+ *  \param width		\IN access width 8, 16 or 32
+ *
+ ****************************************************************************/
+void ID_BusOpenX( ID_BUS *bus, U_INT32_OR_64 base, u_int32 reg,
+				  u_int32 width )
+{
+	switch( width ){
+		case 8:
+			bus->wr = _wr8;
+			bus->rd = _rd8;
+			break;
+		case 32:
+			bus->wr = _wr32;
+			bus->rd = _rd32;
+			break;
+		default:
+			bus->wr = _wr16;
+			bus->rd = _rd16;
+			break;
+	}
+
+	bus->base	= base;
+	bus->reg	= reg;
+	bus->shadow	= ID_BUS_UNKNOWN;
+	bus->writes	= 0;
+	bus->elided	= 0;
+	bus->reads	= 0;
+	bus->lock	= 0;
+	bus->slots	= 1;
+}
+
+/******************************* ID_BusClose *******************************/
+/**   End a transaction, account its counters.
+ *
+ *---------------------------------------------------------------------------
+ *  \param bus			\IN access context
+ *
+ ****************************************************************************/
+void ID_BusClose( ID_BUS *bus )
+{
+	ID_LockAux( ID_AUX_STAT );
+	G_busStat.transactions++;
+	G_busStat.writes	+= bus->writes;
+	G_busStat.elided	+= bus->elided;
+	G_busStat.reads		+= bus->reads;
+	G_busStat.lastWrites = bus->writes;
+	G_busStat.lastElided = bus->elided;
+	G_busStat.lastReads	 = bus->reads;
+	ID_UnlockAux( ID_AUX_STAT );
+
+	ID_Unlock( bus->lock );
+}
+
+/******************************* ID_BusWrite *******************************/
+/**   Write the bit-bang register unless it already holds the value.
+ *
+ *---------------------------------------------------------------------------
+ *  \param bus			\INOUT access context
+ *  \param val			\IN value to write
+ *
+ ****************************************************************************/
+void ID_BusWrite( ID_BUS *bus, u_int32 val )
+{
+	if( val == bus->shadow ){
+		bus->elided++;
+		return;
+	}
+
+	bus->wr( bus, val );
+	bus->shadow = val;
+	bus->writes++;
+}
+
+/******************************* ID_BusRead ********************************/
+/**   Read the bit-bang register.
+ *
+ *---------------------------------------------------------------------------
+ *  \param bus			\INOUT access context
+ *  \return   register value
+ *
+ ****************************************************************************/
+u_int32 ID_BusRead( ID_BUS *bus )
+{
+	bus->reads++;
+	return bus->rd( bus );
+}
+
+/******************************* ID_BusStatGet *****************************/
+/**   Get the register access counters of all bit-bang transactions.
+ *
+ *---------------------------------------------------------------------------
+ *  \param statP		\OUT counters
+ *
+ ****************************************************************************/
+void ID_BusStatGet( ID_BUS_STAT *statP )
+{
+	ID_LockAux( ID_AUX_STAT );
+	*statP = G_busStat;
+	ID_UnlockAux( ID_AUX_STAT );
+}
+
+/******************************* ID_BusStatReset ***************************/
+/**   Clear the register access counters.
+ *
+ ****************************************************************************/
+void ID_BusStatReset( void )
+{
+	ID_LockAux( ID_AUX_STAT );
+	G_busStat.transactions	= 0;
+	G_busStat.writes		= 0;
+	G_busStat.elided		= 0;
+	G_busStat.reads			= 0;
+	G_busStat.lastWrites	= 0;
+	G_busStat.lastElided	= 0;
+	G_busStat.lastReads		= 0;
+	ID_UnlockAux( ID_AUX_STAT );
+}
+
+/******************************* ID_LockInit *******************************/
+/**   Create the lock table.
+ *
+ *    Must be called once before the library is used from more than one
+ *    task. Without the lock table, transactions are not locked.
+ *    Each slot is a binary semaphore; a transaction locks the slot of
+ *    its register (ID_BusOpen(), MCRW handle), so accesses to different
+ *    modules do not wait for each other. The locks of the shared data
+ *    (ID_LockAux()) are created as well.
+ *
+ *---------------------------------------------------------------------------
+ *  \param osHdl		\IN OSS handle
+ *  \return   0 or error code of OSS_SemCreate()
+ *
+ ****************************************************************************/
+int32 ID_LockInit( OSS_HANDLE *osHdl )
+{
+	u_int32 i;
+	int32 error;
+
+	if( G_lockSem[0] != NULL )				/* already created */
+		return 0;
+
+	for( i=0; i<ID_AUX_LOCKS; i++ ){
+		error = OSS_SemCreate( osHdl, OSS_SEM_BIN, 1, &G_auxSem[i] );
+		if( error ){
+			while( i-- )
+				OSS_SemRemove( osHdl, &G_auxSem[i] );
+			return error;
+		}
+	}
+
+	for( i=ID_LOCK_SLOTS; i>0; i-- ){		/* slot 0 last */
+		error = OSS_SemCreate( osHdl, OSS_SEM_BIN, 1, &G_lockSem[i-1] );
+		if( error ){
+			for( ; i<ID_LOCK_SLOTS; i++ )
+				OSS_SemRemove( osHdl, &G_lockSem[i] );
+			for( i=0; i<ID_AUX_LOCKS; i++ )
+				OSS_SemRemove( osHdl, &G_auxSem[i] );
+			return error;
+		}
+	}
+
+	G_lockOs = osHdl;
+	return 0;
+}
+
+/******************************* ID_LockExit *******************************/
+/**   Remove the lock table.
+ *
+ *    No transaction may be active.
+ *
+ ****************************************************************************/
+void ID_LockExit( void )
+{
+	u_int32 i;
+
+	if( G_lockSem[0] == NULL )
+		return;
+
+	for( i=0; i<ID_LOCK_SLOTS; i++ )
+		OSS_SemRemove( G_lockOs, &G_lockSem[i] );
+	G_lockSem[0] = NULL;
+
+	for( i=0; i<ID_AUX_LOCKS; i++ )
+		OSS_SemRemove( G_lockOs, &G_auxSem[i] );
+}
+
+/******************************* ID_LockMask *******************************/
+/**   Get the lock table slot of a register.
+ *
+ *    Module bases are at least 256 bytes apart, so the address bits
+ *    above 8 are folded into the slot number.
+ *
+ *---------------------------------------------------------------------------
+ *  \param addr			\IN register address
+ *  \return   lock mask with the slot bit set
+ *
+ ****************************************************************************/
+u_int32 ID_LockMask( U_INT32_OR_64 addr )
+{
+	u_int32 slot = 0;
+
+	for( addr >>= 8; addr; addr >>= 5 )
+		slot ^= (u_int32)addr;
+
+	return (u_int32)1 << (slot % ID_LOCK_SLOTS);
+}
+
+/******************************* ID_Lock ***********************************/
+/**   Acquire the locks of a lock mask.
+ *
+ *    Slots are always acquired in ascending order, so transactions that
+ *    lock several modules (e.g. m_readmulti()) cannot deadlock.
+ *
+ *---------------------------------------------------------------------------
+ *  \param mask			\IN lock mask (see ID_LockMask())
+ *
+ ****************************************************************************/
+void ID_Lock( u_int32 mask )
+{
+	u_int32 i;
+
+	if( G_lockSem[0] == NULL )
+		return;
+
+	for( i=0; mask; i++, mask >>= 1 )
+		if( mask & 1 )
+			OSS_SemWait( G_lockOs, G_lockSem[i], OSS_SEM_WAITINFINITE );
+}
+
+/******************************* ID_Unlock *********************************/
+/**   Release the locks of a lock mask.
+ *
+ *---------------------------------------------------------------------------
+ *  \param mask			\IN lock mask (see ID_LockMask())
+ *
+ ****************************************************************************/
+void ID_Unlock( u_int32 mask )
+{
+	u_int32 i;
+
+	if( G_lockSem[0] == NULL )
+		return;
+
+	for( i=0; mask; i++, mask >>= 1 )
+		if( mask & 1 )
+			OSS_SemSignal( G_lockOs, G_lockSem[i] );
+}
+
+/******************************* ID_LockAux ********************************/
+/**   Lock data shared by all modules (counters, cache).
+ *
+ *    Held only for a few memory accesses, never while waiting for a
+ *    register lock (ID_Lock()) or the bus.
+ *
+ *---------------------------------------------------------------------------
+ *  \param n			\IN ID_AUX_xxx
+ *
+ ****************************************************************************/
+void ID_LockAux( u_int32 n )
+{
+	if( G_lockSem[0] == NULL )
+		return;
+
+	OSS_SemWait( G_lockOs, G_auxSem[n], OSS_SEM_WAITINFINITE );
+}
+
+/******************************* ID_UnlockAux ******************************/
+/**   Unlock data shared by all modules.
+ *
+ *---------------------------------------------------------------------------
+ *  \param n			\IN ID_AUX_xxx
+ *
+ ****************************************************************************/
+void ID_UnlockAux( u_int32 n )
+{
+	if( G_lockSem[0] == NULL )
+		return;
+
+	OSS_SemSignal( G_lockOs, G_auxSem[n] );
+}
+
+/******************************* _wrXX/_rdXX *******************************/
+/**   Register access of a given width
+ *---------------------------------------------------------------------------
+ *  \param bus			\IN access context
+ *  \param val			\IN value to write
+ *  \return   register value (_rdXX)
+ *
+ ****************************************************************************/
+static void _wr8( ID_BUS *bus, u_int32 val )
+{
+	MWRITE_D8( bus->base, bus->reg, (u_int8)val );
+}
+
+static void _wr16( ID_BUS *bus, u_int32 val )
+{
+	MWRITE_D16( bus->base, bus->reg, (u_int16)val );
+}
+
+static void _wr32( ID_BUS *bus, u_int32 val )
+{
+	MWRITE_D32( bus->base, bus->reg, val );
+}
+
+static u_int32 _rd8( ID_BUS *bus )
+{
+	return MREAD_D8( bus->base, bus->reg );
+}
+
+static u_int32 _rd16( ID_BUS *bus )
+{
+	return MREAD_D16( bus->base, bus->reg );
+}
+
+static u_int32 _rd32( ID_BUS *bus )
+{
+	return MREAD_D32( bus->base, bus->reg );
+}
@@ -36,6 +36,9 @@ MAK_SWITCH=$(SW_PREFIX)ID_SW \
 		   $(SW_PREFIX)MAC_MEM_MAPPED
 
 MAK_INCL=$(MEN_MOD_DIR)/id_var.h \
+         $(MEN_MOD_DIR)/id_ext.h \
+         $(MEN_MOD_DIR)/id_int.h \
+         $(MEN_MOD_DIR)/id_mw.h \
          $(MEN_INC_DIR)/men_typs.h \
          $(MEN_INC_DIR)/dbg.h \
          $(MEN_INC_DIR)/oss.h \
@@ -45,9 +48,13 @@ MAK_INCL=$(MEN_MOD_DIR)/id_var.h \
 MAK_INP1=c_drvadd$(INP_SUFFIX)
 MAK_INP2=microwire_port$(INP_SUFFIX)
 MAK_INP3=usmrw$(INP_SUFFIX)
+MAK_INP4=id_time$(INP_SUFFIX)
+MAK_INP5=id_util$(INP_SUFFIX)
 
 MAK_INP=$(MAK_INP1)\
 		$(MAK_INP2)\
-		$(MAK_INP3)
+		$(MAK_INP3)\
+		$(MAK_INP4)\
+		$(MAK_INP5)
 
 
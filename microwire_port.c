@@ -7,13 +7,14 @@
  *
  *        \brief Microwire bus protocol library for a port emulation.
  *
- *				 This libary don't exclude multiple access.
+ *				 Multiple access is excluded per port after ID_LockInit():
+ *				 a transaction holds the locks of all port registers.
  *
  *     Required: oss
- *     Switches: none
+ *     Switches: ID_NO_STATS - no performance counters in the handle
  *
- *		   Note: Only D16 access implemented.
- *               Only all control/data bits in one register implemented.
+ *		   Note: D8/D16/D32 access, lines in one or separate registers
+ *               with MCRW_DESC_PORT_FLAG_OUT_MAPPED (see _portinit()).
  */
  /*
  *---------------------------------------------------------------------------
@@ -43,12 +44,40 @@
 
 #define MCRW_COMPILE
 #include <MEN/microwire.h>
+#include "id_ext.h"
+#include "id_int.h"
 
 static const char IdentString[]=MENT_XSTR(MAK_REVISION);
 
 /*-----------------------------------------+
 |  TYPEDEFS                                |
 +-----------------------------------------*/
+/** output register of the port (see _portinit()) */
+typedef struct
+{
+	U_INT32_OR_64  addr;		   /* register address */
+	u_int32		   width;	   /* access width 8/16/32 */
+	u_int32		   val[8];	   /* value per line state B_SEL|B_CLK|B_DAT */
+	u_int32		   keep;	   /* bits read back and kept (read-modify-write) */
+	u_int32		   other;	   /* kept bits read at start of transaction */
+	ID_BUS		   bus;		   /* access of current transaction */
+}MCRW_OREG;
+
+#ifndef ID_NO_STATS
+/** performance counters of a handle (see MCRW_IOCTL_STAT_xxx) */
+typedef struct
+{
+	u_int32		   wordsRead;  /* words read by the user */
+	u_int32		   wordsWritten; /* words programmed */
+	u_int32		   busAccesses; /* register reads and writes */
+	u_int32		   delayUs;	   /* bit delays and ready polling back-off */
+	u_int32		   polls;	   /* ready polling back-offs */
+	u_int32		   progMaxUs;  /* max. programming time (back-off sum) */
+	u_int32		   verifyErrs; /* verify failures */
+	u_int32		   timeouts;   /* ready polling timeouts */
+}MCRW_STAT;
+#endif
+
 typedef struct
 {
 	/* function entries */
@@ -58,27 +87,65 @@ typedef struct
 	u_int32        ownSize;
 	OSS_HANDLE 	   *osHdl;
 	MCRW_DESC_PORT desc;
-	u_int32		   outDefault; /* if all DATA out in one register */
+	MCRW_OREG	   oreg[3];	   /* output registers (CS, CLK, DI) */
+	u_int32		   nOreg;	   /* number of output registers */
+	U_INT32_OR_64  inAddr;	   /* input register (DO) */
+	u_int32		   inWidth;	   /* access width 8/16/32 */
+	u_int32		   inMask;	   /* DO bit */
+	u_int32		   inXor;	   /* DO polarity, inMask if low active */
+	ID_BUS		   in;		   /* input access of current transaction */
+	u_int32		   lock;	   /* lock mask of the port registers */
+	u_int32		   lastWrites; /* register writes of last access */
+	u_int32		   writeFlags; /* ID_WF_xxx */
+	ID_POLL		   poll;	   /* ready polling configuration */
+	u_int32		   written;	   /* words programmed by last write */
+	u_int32		   halfNs;	   /* half bit period [ns], 0 = no delay */
+#ifndef ID_NO_STATS
+	MCRW_STAT	   stat;	   /* performance counters */
+	u_int32		   delays;	   /* delay() calls of current transaction */
+#endif
 }MCRW_HANDLE;
 
 /*-----------------------------------------+
 |  DEFINES & CONST                         |
 +-----------------------------------------*/
 /*--- instructions for serial EEPROM ---*/
-#define     _READ_   0x80    /* read data */
-#define     EWEN    0x30    /* enable erase/write state */
-#define     ERASE   0xc0    /* erase cell */
-#define     _WRITE_  0x40    /* write data */
-#define     ERAL    0x20    /* chip erase */
-#define     WRAL    0x10    /* chip write */
-#define     EWDS    0x00    /* disable erase/write state */
+/* 2 bit opcode followed by <addrLength> address bits */
+#define     _READ_   0x2     /* read data */
+#define     _WRITE_  0x1     /* write data */
+#define     ERASE    0x3     /* erase cell */
+#define     _EXT_    0x0     /* extended, 2 MSBs of address select: */
+#define     EWEN     0x3     /*   enable erase/write state */
+#define     ERAL     0x2     /*   chip erase */
+#define     WRAL     0x1     /*   chip write */
+#define     EWDS     0x0     /*   disable erase/write state */
+
+/* instruction code for the handle's address length */
+#define OPCODE(h,op,addr)	(((u_int32)(op) << (h)->desc.addrLength) | (u_int32)(addr))
+#define EXTCODE(h,ext)		((u_int32)(ext) << ((h)->desc.addrLength - 2))
+
+#define DIFF_CHUNK	16				/* words compared per burst read */
+
+/* non-blocking write (ID_AWRITE.state) */
+#define AW_NEXT		0				/* program next word */
+#define AW_ERASING	1				/* wait for end of ERASE */
+#define AW_WRITING	2				/* wait for end of WRITE */
+#define AW_DONE		3				/* finished, job->error valid */
+
+#define SLEEP_NS	500000			/* sleep for half bit periods >= 500us */
+
+/* performance counter update */
+#ifdef ID_NO_STATS
+# define STAT(x)
+#else
+# define STAT(x)		x
+#endif
 
-#define     T_WP    10000   /* max. time required for write/erase (us) */
+#define ADDR_LEN_MIN	6			/* address bits 93C46 */
+#define ADDR_LEN_MAX	11			/* address bits (x16: 2048 words) */
 
-/* bit definition */
-#define B_DAT	0x01				/* data in-;output		*/
-#define B_CLK	0x02				/* clock				*/
-#define B_SEL	0x04				/* chip-select			*/
+/* device size [byte] (x16 organization) */
+#define DEV_SIZE(h)		((u_int32)2 << (h)->desc.addrLength)
 
 
 #ifdef _UCC
@@ -107,8 +174,14 @@ static int32 mcrwWriteEeprom ( MCRW_HANDLE *mcrwHdl, u_int8 addr, u_int16 *buf,
 static int32 mcrwReadEeprom  ( MCRW_HANDLE *mcrwHdl, u_int8 addr, u_int16 *buf, u_int16 size );
 static int32 mcrwSetStat	 ( MCRW_HANDLE *mcrwHdl, int32 code,  int32 data   );
 static int32 mcrwGetStat	 ( MCRW_HANDLE *mcrwHdl, int32 code,  int32 *dataP );
-static u_int16 m_read_loc    ( MCRW_HANDLE *mcrwHdl, void *base, u_int8 index );
-static int m_write_loc       ( MCRW_HANDLE *mcrwHdl, void *base, u_int8  index, u_int16 data );
+static int _waitready        ( MCRW_HANDLE *mcrwHdl );
+static u_int16 m_read_loc    ( MCRW_HANDLE *mcrwHdl, u_int32 index );
+static int32 _writesession   ( MCRW_HANDLE *mcrwHdl, u_int32 index, int count, u_int16 *buf );
+static int32 _writeall       ( MCRW_HANDLE *mcrwHdl, u_int16 *buf, int count );
+static int _erasecell        ( MCRW_HANDLE *mcrwHdl, u_int32 index );
+static int _writecell        ( MCRW_HANDLE *mcrwHdl, u_int32 code, u_int16 data );
+static int _awstep           ( ID_AWRITE *job );
+static int _awerror          ( MCRW_HANDLE *mcrwHdl, ID_AWRITE *job, int32 error );
 
 /*****************************  mcrwIdent  *********************************/
 /** Gets the pointer to ident string.
@@ -124,12 +197,12 @@ static char* mcrwIdent( void )
 }/*mcrwIdent*/
 
 /************************************* delay *******************************/
-/** Delay	descriptor dependend time.
+/** Delay half a bit period of the bus clock.
  *
- *		   Note:  busClock descriptor value \n
+ *		   Note:  bus clock [kHz] (descriptor or MCRW_IOCTL_BUS_CLOCK) \n
  *					 0 - max speed - no delay\n
- *					 1 -  1kHz  OSS_Delay()\n
- *					10 - 10kHz  OSS_MikroDelay()
+ *					<2 - OSS_Delay() (half period >= 500us)\n
+ *					else calibrated busy-wait ID_DelayNs()
  *
  *---------------------------------------------------------------------------
  *  \param mcrwHdl	\IN pointer to mcrw handle
@@ -140,242 +213,706 @@ __inline__ static void delay
 	MCRW_HANDLE  *mcrwHdl
 )
 {
-	switch( mcrwHdl->desc.busClock )
-	{
-		case 1:  /* 1kHz max */
-			OSS_Delay( mcrwHdl->osHdl, 1 );
-			break;
-		case 10: /* 10kHz max */
-			OSS_MikroDelay( mcrwHdl->osHdl, 100 );
-			break;
-		default: /* max speed */
-			break;
-	}/*switch*/
+	STAT( mcrwHdl->delays++ );
+
+	if( mcrwHdl->halfNs >= SLEEP_NS )
+		OSS_Delay( mcrwHdl->osHdl,
+				   (int32)((mcrwHdl->halfNs + 999999) / 1000000) );
+	else if( mcrwHdl->halfNs )
+		ID_DelayNs( mcrwHdl->halfNs );
 }/*delay*/
 
+/************************************* halfperiod **************************/
+/** Get the half bit period of a bus clock.
+ *
+ *---------------------------------------------------------------------------
+ *  \param busClock	\IN bus clock [kHz] (0 = max speed)
+ *  \return half bit period [ns], 0 = no delay
+ *
+ ****************************************************************************/
+static u_int32 halfperiod( u_int32 busClock )
+{
+	if( busClock == 0 )
+		return( 0 );
+
+	/* round up, the clock must not exceed busClock */
+	return( (500000 + busClock - 1) / busClock );
+}/*halfperiod*/
+
 
 /*----------------------------------------------------------------------
  * LOW-LEVEL ROUTINES FOR SERIAL EEPROM
  *--------------------------------------------------------------------*/
 
-/******************************* _select ***********************************/
-/** Select EEPROM:
- *                 output DI/CLK/CS low
- *                 delay
- *                 output CS high
- *                 delay
+/******************************* _port *************************************/
+/** Output a line state:
+ *                 write the precomputed value of each output register
+ *                 with the kept bits of the register,
+ *                 unchanged registers are elided (see ID_BusWrite())
  *---------------------------------------------------------------------------
- *  \param mcrwHdl		\IN handle pointer
- *  \param base			\IN base address 
+ *	\param mcrwHdl		\IN MCRW handle pointer
+ *	\param state		\IN line state B_SEL|B_CLK|B_DAT
  *
  ***************************************************************************/
-static void _select(MCRW_HANDLE  *mcrwHdl, void *base )	
+__inline__ static void _port(MCRW_HANDLE  *mcrwHdl, u_int32 state )
 {
-    MWRITE_D16( base, 0, (0 | mcrwHdl->outDefault) );			/* everything inactive */
-    delay(mcrwHdl);
-    MWRITE_D16( base, 0, (B_SEL | mcrwHdl->outDefault) );		/* select high */
-    delay(mcrwHdl);
+    u_int32 r;
+
+    for( r=0; r<mcrwHdl->nOreg; r++ )
+        ID_BusWrite( &mcrwHdl->oreg[r].bus,
+                     mcrwHdl->oreg[r].val[state] | mcrwHdl->oreg[r].other );
 }
 
-/******************************* _deselect *********************************/
-/** Deselect EEPROM
- *                 output CS low
+/******************************* _sample ***********************************/
+/** Sample the DO line
  *---------------------------------------------------------------------------
- *	\param mcrwHdl		\IN MCRW handle pointer 
- *	\param base			\IN base address pointer
+ *	\param mcrwHdl		\IN MCRW handle pointer
+ *	\return state of DO line (0/1)
+ *
  ***************************************************************************/
-static void _deselect(MCRW_HANDLE  *mcrwHdl, void *base )	
+__inline__ static int _sample(MCRW_HANDLE  *mcrwHdl )
 {
-    MWRITE_D16( base, 0, (0 | mcrwHdl->outDefault) );			/* everything inactive */
+    return( ((ID_BusRead( &mcrwHdl->in ) ^ mcrwHdl->inXor)
+             & mcrwHdl->inMask) != 0 );
 }
 
+/*--- Microwire engine on the descriptor's port (see id_mw.h),
+      register address and width are known at run time only ---*/
+#define ID_MW_HDL				MCRW_HANDLE
+#define ID_MW_OUT(h,state)		_port( h, state )
+#define ID_MW_IN(h)				_sample( h )
+#define ID_MW_DELAY(h)			delay( h )
+#define ID_MW_CODEBITS(h)		((h)->desc.addrLength + 2)
+#define ID_MW_READ(h,index)		OPCODE( h, _READ_, index )
+#include "id_mw.h"
+
+/******************************* _portopen *********************************/
+/** Start a transaction on all port registers, read the kept bits of
+ *  read-modify-write registers
+ *---------------------------------------------------------------------------
+ *	\param mcrwHdl		\IN MCRW handle pointer
+ *
+ ***************************************************************************/
+static void _portopen(MCRW_HANDLE  *mcrwHdl )
+{
+    MCRW_OREG   *oreg;
+    u_int32     r;
+
+    ID_Lock( mcrwHdl->lock );
+    for( r=0; r<mcrwHdl->nOreg; r++ ){
+        oreg = &mcrwHdl->oreg[r];
+        ID_BusOpenX( &oreg->bus, oreg->addr, 0, oreg->width );
+        oreg->other = oreg->keep ? (ID_BusRead( &oreg->bus ) & oreg->keep) : 0;
+    }
+    ID_BusOpenX( &mcrwHdl->in, mcrwHdl->inAddr, 0, mcrwHdl->inWidth );
+    STAT( mcrwHdl->delays = 0 );
+}
 
-/******************************* _clock ***********************************/
-/**   Output data bit:
- *                 output clock low
- *                 output data bit
- *                 delay
- *                 output clock high
- *                 delay
- *                 return state of data serial eeprom's DO - line
- *                 (Note: keep CS asserted)
+/******************************* _portclose ********************************/
+/** End a transaction, account the accesses of all registers as one
+ *  and update the performance counters
  *---------------------------------------------------------------------------
  *	\param mcrwHdl		\IN MCRW handle pointer
- *	\param base			\IN base address pointer
- *	\param dbs			\IN data bit set
- *	\return state of DO line
- *  
+ *
  ***************************************************************************/
-static int _clock(MCRW_HANDLE  *mcrwHdl, void *base, u_int8 dbs )	
+static void _portclose(MCRW_HANDLE  *mcrwHdl )
 {
-    MWRITE_D16( base, 0, dbs|B_SEL| (u_int16)mcrwHdl->outDefault );  /* output clock low */
-                                            /* output data high/low */
-    delay(mcrwHdl);                               /* delay    */
+    ID_BUS  *bus = &mcrwHdl->oreg[0].bus;
+    u_int32 r;
 
-    MWRITE_D16( base, 0, dbs|B_CLK|B_SEL| (u_int16)mcrwHdl->outDefault );  /* output clock high */
-    delay(mcrwHdl);                               /* delay    */
+    for( r=1; r<mcrwHdl->nOreg; r++ ){
+        bus->writes += mcrwHdl->oreg[r].bus.writes;
+        bus->elided += mcrwHdl->oreg[r].bus.elided;
+    }
+    bus->reads += mcrwHdl->in.reads;
 
-    return( MREAD_D16( base, 0) & B_DAT );  /* get data */
+    mcrwHdl->lastWrites = bus->writes;
+#ifndef ID_NO_STATS
+    mcrwHdl->stat.busAccesses += bus->writes + bus->reads;
+    mcrwHdl->stat.delayUs += mcrwHdl->delays * (mcrwHdl->halfNs / 1000)
+        + (mcrwHdl->delays * (mcrwHdl->halfNs % 1000)) / 1000;
+#endif
+    ID_BusClose( bus );
+    ID_Unlock( mcrwHdl->lock );
 }
 
+/******************************* _portwidth ********************************/
+/** Get access width of descriptor flags
+ *---------------------------------------------------------------------------
+ *	\param flags		\IN MCRW_DESC_PORT_FLAG_xxx
+ *	\return access width 8/16/32
+ *
+ ***************************************************************************/
+static u_int32 _portwidth( u_int32 flags )
+{
+    if( flags & MCRW_DESC_PORT_FLAG_SIZE_16 )
+        return 16;
+    if( flags & MCRW_DESC_PORT_FLAG_SIZE_32 )
+        return 32;
+    return 8;
+}
+
+/******************************* _portfixed ********************************/
+/** Map the line states to the fixed bits of the DATA IN register
+ *
+ *    Descriptors without MCRW_DESC_PORT_FLAG_OUT_MAPPED: all lines high
+ *    active at B_SEL/B_CLK/B_DAT of the 16-bit DATA IN register, the
+ *    other bits are the merged not read back defaults. Masks, polarity
+ *    and sizes of the lines are not evaluated.
+ *
+ *---------------------------------------------------------------------------
+ *	\param mcrwHdl		\IN MCRW handle pointer
+ *
+ ***************************************************************************/
+static void _portfixed(MCRW_HANDLE  *mcrwHdl )
+{
+    MCRW_DESC_PORT *d = &mcrwHdl->desc;
+    MCRW_OREG   *oreg = &mcrwHdl->oreg[0];
+    u_int32     st, dflt;
+
+    dflt = d->notReadBackDefaultsDataOut    /* merge out defaults */
+         & d->notReadBackDefaultsClockOut
+         & d->notReadBackDefaultsCsOut;
+
+    oreg->addr  = (U_INT32_OR_64)d->addrDataIn;
+    oreg->width = 16;
+    oreg->keep  = 0;
+    for( st=0; st<8; st++ )
+        oreg->val[st] = st | dflt;
+    mcrwHdl->nOreg = 1;
+
+    mcrwHdl->inAddr  = oreg->addr;
+    mcrwHdl->inWidth = 16;
+    mcrwHdl->inMask  = B_DAT;
+    mcrwHdl->inXor   = 0;
+}
+
+/******************************* _portmap **********************************/
+/** Map the line states to the descriptor's registers
+ *
+ *    Descriptors with MCRW_DESC_PORT_FLAG_OUT_MAPPED: lines with the same
+ *    register address share one output register. For each register and
+ *    each of the 8 line states the value to write is computed once
+ *    (masks, polarity, not read back defaults), so no descriptor
+ *    evaluation is left for the single clock edges.
+ *    The other bits of a readable register (READABLE_REG) are read at
+ *    the start of a transaction and kept, except the bits of its
+ *    notReadBackMask, which get the notReadBackDefaults.
+ *
+ *---------------------------------------------------------------------------
+ *	\param mcrwHdl		\IN MCRW handle pointer
+ *	\return 0 or error code
+ *
+ ***************************************************************************/
+static int32 _portmap(MCRW_HANDLE  *mcrwHdl )
+{
+    MCRW_DESC_PORT *d = &mcrwHdl->desc;
+    struct {
+        void    *addr;
+        u_int32 flags, mask, dflt, nrb, state;
+    } line[3];
+    u_int32     dflt[3], nrb[3], lmask[3], rdable[3];
+    u_int32     l, r, st, v;
+    MCRW_OREG   *oreg;
+
+    line[0].addr = d->addrDataOut;  line[0].flags = d->flagsDataOut;
+    line[0].mask = d->maskDataOut;  line[0].dflt  = d->notReadBackDefaultsDataOut;
+    line[0].nrb  = d->notReadBackMaskDataOut;   line[0].state = B_DAT;
+    line[1].addr = d->addrClockOut; line[1].flags = d->flagsClockOut;
+    line[1].mask = d->maskClockOut; line[1].dflt  = d->notReadBackDefaultsClockOut;
+    line[1].nrb  = d->notReadBackMaskClockOut;  line[1].state = B_CLK;
+    line[2].addr = d->addrCsOut;    line[2].flags = d->flagsCsOut;
+    line[2].mask = d->maskCsOut;    line[2].dflt  = d->notReadBackDefaultsCsOut;
+    line[2].nrb  = d->notReadBackMaskCsOut;     line[2].state = B_SEL;
+
+    if( d->flagsOut & MCRW_DESC_PORT_FLAG_OUT_IN_ONE_REG )
+        for( l=0; l<3; l++ ){               /* all outs in DATA IN reg. */
+            line[l].addr  = d->addrDataIn;
+            line[l].flags = (line[l].flags & ~(MCRW_DESC_PORT_FLAG_SIZE_MASK
+                                           | MCRW_DESC_PORT_FLAG_READABLE_REG))
+                            | (d->flagsDataIn & (MCRW_DESC_PORT_FLAG_SIZE_MASK
+                                           | MCRW_DESC_PORT_FLAG_READABLE_REG));
+        }
+
+    /*--- assign lines to registers ---*/
+    mcrwHdl->nOreg = 0;
+    for( l=0; l<3; l++ ){
+        for( r=0; r<mcrwHdl->nOreg; r++ )
+            if( mcrwHdl->oreg[r].addr == (U_INT32_OR_64)line[l].addr )
+                break;
+
+        if( r == mcrwHdl->nOreg ){          /* new register */
+            mcrwHdl->oreg[r].addr  = (U_INT32_OR_64)line[l].addr;
+            mcrwHdl->oreg[r].width = _portwidth( line[l].flags );
+            dflt[r]   = 0xffffffff;
+            nrb[r]    = 0;
+            lmask[r]  = 0;
+            rdable[r] = MCRW_DESC_PORT_FLAG_READABLE_REG;
+            mcrwHdl->nOreg++;
+        }
+        else if( mcrwHdl->oreg[r].width != _portwidth( line[l].flags ) )
+            return( MCRW_ERR_DESCRIPTOR );  /* same reg., other width */
+
+        dflt[r]   &= line[l].dflt;          /* merge out defaults */
+        nrb[r]    |= line[l].nrb;
+        lmask[r]  |= line[l].mask;
+        rdable[r] &= line[l].flags;
+    }
+
+    /*--- register value per line state ---*/
+    for( r=0; r<mcrwHdl->nOreg; r++ ){
+        oreg = &mcrwHdl->oreg[r];
+        oreg->keep = rdable[r] ? ~(lmask[r] | nrb[r]) : 0;
+        if( oreg->addr == (U_INT32_OR_64)d->addrDataIn )
+            oreg->keep &= ~d->maskDataIn;   /* DO is not written back */
+        for( st=0; st<8; st++ ){
+            v = dflt[r] & ~lmask[r] & ~oreg->keep;
+            for( l=0; l<3; l++ ){
+                if( (U_INT32_OR_64)line[l].addr != oreg->addr )
+                    continue;
+                /* line high: active and high active or inactive and low active */
+                if( !(st & line[l].state) ==
+                    !(line[l].flags & MCRW_DESC_PORT_FLAG_POLARITY_HIGH) )
+                    v |= line[l].mask;
+            }
+            oreg->val[st] = v;
+        }
+    }
+
+    /*--- input ---*/
+    mcrwHdl->inAddr  = (U_INT32_OR_64)d->addrDataIn;
+    mcrwHdl->inWidth = _portwidth( d->flagsDataIn );
+    mcrwHdl->inMask  = d->maskDataIn;
+    mcrwHdl->inXor   = (d->flagsDataIn & MCRW_DESC_PORT_FLAG_POLARITY_HIGH) ?
+                       0 : d->maskDataIn;
+
+    return( MCRW_ERR_NO );
+}
+
+/******************************* _portinit *********************************/
+/** Map the line states to the port registers (see _portfixed(),
+ *  _portmap()) and get the locks of all port registers
+ *
+ *---------------------------------------------------------------------------
+ *	\param mcrwHdl		\IN MCRW handle pointer
+ *	\return 0 or error code
+ *
+ ***************************************************************************/
+static int32 _portinit(MCRW_HANDLE  *mcrwHdl )
+{
+    u_int32     r;
+    int32       error;
+
+    if( !(mcrwHdl->desc.flagsOut & MCRW_DESC_PORT_FLAG_OUT_MAPPED) )
+        _portfixed( mcrwHdl );
+    else if( (error = _portmap( mcrwHdl )) != MCRW_ERR_NO )
+        return( error );
+
+    /*--- locks of all registers ---*/
+    mcrwHdl->lock = ID_LockMask( mcrwHdl->inAddr );
+    for( r=0; r<mcrwHdl->nOreg; r++ )
+        mcrwHdl->lock |= ID_LockMask( mcrwHdl->oreg[r].addr );
+
+    return( MCRW_ERR_NO );
+}
 
 /*----------------------------------------------------------------------
  * HIGH-LEVEL ROUTINES FOR SERIAL EEPROM
  *--------------------------------------------------------------------*/
-/******************************* _opcode ***********************************/
-/**   Output opcode with leading startbit
+/******************************* _writesession ****************************/
+/**   Write <count> words starting at <index> in one write session.
  *
- *---------------------------------------------------------------------------
- *	\param mcrwHdl		\IN MCRW handle pointer
- *	\param base			\IN base address pointer
- *	\param code			\IN operation code
+ *    EWEN is sent once before the first programmed word and EWDS once
+ *    after the last word, also on every error path.
+ *
+ *    With ID_WF_DIFF the current contents is burst read in chunks of
+ *    DIFF_CHUNK words; words that already hold the data are skipped,
+ *    erased words are not erased again.
  *
+ *---------------------------------------------------------------------------
+ *  \param mcrwHdl		\IN MCRW handle pointer
+ *	\param index		\IN first index to write
+ *	\param count		\IN number of words to write
+ *	\param buf			\IN words to write
+ *	\return 0 or error code
+ *  
  ***************************************************************************/
-static void _opcode(MCRW_HANDLE  *mcrwHdl, void *base, u_int8 code )	
+static int32 _writesession(MCRW_HANDLE  *mcrwHdl, u_int32 index,
+                           int count, u_int16 *buf )	
 {
-    register int i;
+    u_int16         cur[DIFF_CHUNK];        /* current contents */
+    register u_int16 data;                  /* data word    */
+    register int    n;                      /* counter      */
+    int             erase;                  /* erase word first */
+    int             enabled = FALSE;        /* EWEN sent    */
+    u_int32         flags = mcrwHdl->writeFlags;
+    int32           error = MCRW_ERR_NO;
+
+    mcrwHdl->written = 0;
+
+    for( n=0; n<count; n++, index++ )
+    {
+        data  = buf[n];
+        erase = !(flags & ID_WF_NOERASE);
+
+        if( flags & ID_WF_DIFF )
+        {
+            if( (n % DIFF_CHUNK) == 0 )
+                _readburst( mcrwHdl, index,
+                            (count-n) < DIFF_CHUNK ? count-n : DIFF_CHUNK,
+                            cur );
+            if( cur[n % DIFF_CHUNK] == data )           /* already there */
+                continue;
+            if( cur[n % DIFF_CHUNK] == ID_ERASED_WORD ) /* already erased */
+                erase = FALSE;
+        }
+
+        if( !enabled )
+        {
+            _opcode(mcrwHdl, EXTCODE(mcrwHdl,EWEN)); /* write enable */
+            _deselect(mcrwHdl);                      /* deselect     */
+            enabled = TRUE;
+        }
+
+        if( erase && _erasecell(mcrwHdl, index) ){
+            error = MCRW_ERR_ERASE;
+            break;
+        }
 
-    _select(mcrwHdl, base);
-    _clock(mcrwHdl, base,1);                         /* output start bit */
+        if( _writecell(mcrwHdl, OPCODE(mcrwHdl,_WRITE_,index), data) ){
+            error = MCRW_ERR_WRITE;
+            break;
+        }
+        mcrwHdl->written++;
 
-    for(i=7; i>=0; i--)
-        _clock(mcrwHdl, base,(u_int8)((code>>i)&0x01) );        /* output instruction code  */
+        if( data != m_read_loc(mcrwHdl, index) ){        /* verify data  */
+            STAT( mcrwHdl->stat.verifyErrs++ );
+            error = MCRW_ERR_WRITE_VERIFY;
+            break;
+        }
+    }
+
+    if( enabled )
+    {
+        _opcode(mcrwHdl, EXTCODE(mcrwHdl,EWDS));     /* write disable*/
+        _deselect(mcrwHdl);                          /* disable      */
+    }
+
+    return error;
 }
 
-/******************************* _write ***********************************/
-/**   Write a specified word into EEPROM at 'base'.
+/******************************* _writeall ********************************/
+/**   Program the whole EEPROM with ERAL/WRAL.
+ *
+ *    ERAL erases the device in one cycle, WRAL writes the fill value
+ *    if that saves cycles (see ID_FillValue()). Then only words that differ from the fill
+ *    value are programmed and the device is verified.
  *
  *---------------------------------------------------------------------------
  *  \param mcrwHdl		\IN MCRW handle pointer
- *	\param base			\IN base address pointer
- *	\param index		\IN index to write (0..63)
- *	\param data			\IN word to write
- *	\return 0=ok 1=write err 2=verify err
+ *	\param buf			\IN image
+ *	\param count		\IN number of words (device size)
+ *	\return 0 or error code
  *  
  ***************************************************************************/
-static int _write(MCRW_HANDLE  *mcrwHdl, void *base, u_int8 index, u_int16 data )	
+static int32 _writeall(MCRW_HANDLE  *mcrwHdl, u_int16 *buf,
+                       int count )	
 {
-    register int    i,j;                    /* counters     */
+    u_int16         fill;
+    int             index;
+    int32           error = MCRW_ERR_NO;
 
-    _opcode(mcrwHdl, base,EWEN);                     /* write enable */
-    _deselect(mcrwHdl, base);                        /* deselect     */
+    fill = ID_FillValue( buf, (u_int32)count, mcrwHdl->writeFlags );
+    mcrwHdl->written = 0;
 
-    _opcode(mcrwHdl, base, (u_int8)(_WRITE_+index) );             /* select write */
-    for(i=15; i>=0; i--)
-        _clock(mcrwHdl, base,(u_int8)((data>>i)&0x01));        /* write data   */
-    _deselect(mcrwHdl, base);                        /* deselect     */
+    _opcode(mcrwHdl, EXTCODE(mcrwHdl,EWEN));         /* write enable */
+    _deselect(mcrwHdl);                              /* deselect     */
 
-    _select(mcrwHdl, base);
-    for(i=T_WP; i>0; i--)                   /* wait for low */
-    {   if(!_clock(mcrwHdl, base,0))
-            break;
-        delay(mcrwHdl);
+    _opcode(mcrwHdl, EXTCODE(mcrwHdl,ERAL));         /* chip erase   */
+    _deselect(mcrwHdl);
+    if( _waitready(mcrwHdl) ){
+        error = MCRW_ERR_ERASE;
+        goto DISABLE;
     }
-    for(j=T_WP; j>0; j--)                   /* wait for high*/
-    {   if(_clock(mcrwHdl, base,0))
-            break;
-        delay(mcrwHdl);
+
+    if( fill != ID_ERASED_WORD &&                    /* chip write   */
+        _writecell(mcrwHdl, EXTCODE(mcrwHdl,WRAL), fill) ){
+        error = MCRW_ERR_WRITE;
+        goto DISABLE;
     }
 
-    _opcode(mcrwHdl, base, EWDS);                    /* write disable*/
-    _deselect(mcrwHdl, base);                        /* disable      */
+    for( index=0; index<count; index++ )
+    {
+        if( buf[index] == fill )
+            continue;
+
+        if( fill != ID_ERASED_WORD &&
+            !(mcrwHdl->writeFlags & ID_WF_NOERASE) &&
+            _erasecell(mcrwHdl, (u_int32)index) ){
+            error = MCRW_ERR_ERASE;
+            goto DISABLE;
+        }
+
+        if( _writecell(mcrwHdl, OPCODE(mcrwHdl,_WRITE_,index), buf[index]) ){
+            error = MCRW_ERR_WRITE;
+            goto DISABLE;
+        }
+        mcrwHdl->written++;
+    }
 
-    if((i==0) || (j==0))                    /* error ?      */
-        return MCRW_ERR_WRITE;                           /* ..yes */
+DISABLE:
+    _opcode(mcrwHdl, EXTCODE(mcrwHdl,EWDS));         /* write disable*/
+    _deselect(mcrwHdl);                              /* disable      */
 
-    if( data != m_read_loc(mcrwHdl, base,index) )        /* verify data  */
-        return MCRW_ERR_WRITE_VERIFY;                           /* ..error      */
+    if( error )
+        return error;
 
-    return 0;                               /* ..no         */
+    for( index=0; index<count; index++ )             /* verify data  */
+        if( buf[index] != m_read_loc(mcrwHdl, (u_int32)index) ){
+            STAT( mcrwHdl->stat.verifyErrs++ );
+            return MCRW_ERR_WRITE_VERIFY;
+        }
+
+    return MCRW_ERR_NO;
 }
 
-/******************************* _erase ***********************************/
-/**   Erase a specified word into EEPROM
+/******************************* _erasecell *******************************/
+/**   Erase one word and wait for ready (erase/write must be enabled)
  *
  *---------------------------------------------------------------------------
  *  \param mcrwHdl		\IN MCRW handle pointer
- *	\param base			\IN base address pointer
- *	\param index		\IN index to erase (0..15)
- *  \return   0=ok 1=error
+ *	\param index		\IN index to erase
+ *  \return   0=ok 1=timeout
  *  
  ***************************************************************************/
-static int _erase(MCRW_HANDLE  *mcrwHdl, void *base, u_int8 index )	
+static int _erasecell(MCRW_HANDLE  *mcrwHdl, u_int32 index )	
 {
-    register int    i,j;                    /* counters     */
+    _opcode(mcrwHdl, OPCODE(mcrwHdl,ERASE,index) );  /* select erase */
+    _deselect(mcrwHdl);                              /* deselect     */
 
-    _opcode(mcrwHdl, base,EWEN);                     /* erase enable */
-    for(i=0;i<4;i++) _clock(mcrwHdl, base,0);
-    _deselect(mcrwHdl, base);                        /* deselect     */
+    return _waitready(mcrwHdl);                      /* wait for ready */
+}
 
-    _opcode(mcrwHdl, base,(u_int8)(ERASE+index) );              /* select erase */
-    _deselect(mcrwHdl, base);                        /* deselect     */
+/******************************* _writecell *******************************/
+/**   Send WRITE or WRAL with data and wait for ready
+ *    (erase/write must be enabled)
+ *
+ *---------------------------------------------------------------------------
+ *  \param mcrwHdl		\IN MCRW handle pointer
+ *	\param code			\IN instruction code (WRITE or WRAL)
+ *	\param data			\IN word to write
+ *  \return   0=ok 1=timeout
+ *  
+ ***************************************************************************/
+static int _writecell(MCRW_HANDLE  *mcrwHdl, u_int32 code, u_int16 data )	
+{
+    _writeop(mcrwHdl, code, data);                   /* start programming */
 
-    _select(mcrwHdl, base);
-    for(i=T_WP; i>0; i--)                   /* wait for low */
-    {   if(!_clock(mcrwHdl, base,0))
-            break;
-        delay(mcrwHdl);
-    }
+    return _waitready(mcrwHdl);                      /* wait for ready */
+}
 
-    for(j=T_WP; j>0; j--)                   /* wait for high*/
-    {   if(_clock(mcrwHdl, base,0))
+/******************************* _awstep **********************************/
+/**   ID_WriteStep() of MCRW_PORT_WriteStart() jobs
+ *
+ *    While a programming cycle runs, each step selects the EEPROM again
+ *    (the port may have been used between two steps) and samples DO
+ *    once. DO high means ready, no busy sample is required, so steps
+ *    slower than the programming time do not time out. Then the word is
+ *    verified and the next ERASE or WRITE is shifted out. EWDS is sent
+ *    at the end and on every error.
+ *
+ *---------------------------------------------------------------------------
+ *	\param job			\INOUT write job
+ *  \return   ID_AW_xxx
+ *  
+ ***************************************************************************/
+static int _awstep( ID_AWRITE *job )
+{
+    MCRW_HANDLE     *mcrwHdl = (MCRW_HANDLE*)job->hdl;
+    u_int16         rd;
+    int             erase;
+    int             rv;
+
+    if( job->state == AW_DONE )
+        return job->error ? ID_AW_ERROR : ID_AW_DONE;
+
+    _portopen( mcrwHdl );
+
+    for(;;)
+    {
+        if( job->state == AW_NEXT )
+        {
+            if( job->count == 0 ){
+                _opcode(mcrwHdl, EXTCODE(mcrwHdl,EWDS)); /* write disable*/
+                _deselect(mcrwHdl);
+                job->state = AW_DONE;
+                rv = ID_AW_DONE;
+                break;
+            }
+
+            erase = !(job->flags & ID_WF_NOERASE);
+            if( job->flags & ID_WF_DIFF ){
+                rd = m_read_loc(mcrwHdl, job->index);
+                if( rd == *job->buff ){                  /* already there */
+                    job->index++;
+                    job->buff++;
+                    job->count--;
+                    continue;
+                }
+                if( rd == ID_ERASED_WORD )               /* already erased */
+                    erase = FALSE;
+            }
+
+            if( erase ){
+                _opcode(mcrwHdl, OPCODE(mcrwHdl,ERASE,job->index) );
+                _deselect(mcrwHdl);
+                job->state = AW_ERASING;
+            }
+            else {
+                _writeop(mcrwHdl, OPCODE(mcrwHdl,_WRITE_,job->index),
+                         *job->buff);
+                job->state = AW_WRITING;
+            }
+            ID_PollStart( job, &mcrwHdl->poll );
+            rv = ID_AW_BUSY;
             break;
-        delay(mcrwHdl);
+        }
+
+        /* AW_ERASING, AW_WRITING: select and sample once */
+        _select(mcrwHdl, 0);                             /* DO = ready/busy */
+        if( _sample( mcrwHdl ) ){
+            _deselect(mcrwHdl);
+            if( job->state == AW_ERASING ){              /* erased: write */
+                _writeop(mcrwHdl, OPCODE(mcrwHdl,_WRITE_,job->index),
+                         *job->buff);
+                job->state = AW_WRITING;
+                ID_PollStart( job, &mcrwHdl->poll );
+                rv = ID_AW_BUSY;
+                break;
+            }
+
+            job->written++;
+            STAT( mcrwHdl->stat.wordsWritten++ );
+            if( *job->buff != m_read_loc(mcrwHdl, job->index) ){ /* verify */
+                STAT( mcrwHdl->stat.verifyErrs++ );
+                rv = _awerror( mcrwHdl, job, MCRW_ERR_WRITE_VERIFY );
+                break;
+            }
+
+            job->index++;
+            job->buff++;
+            job->count--;
+            job->state = AW_NEXT;
+            continue;
+        }
+
+        _deselect(mcrwHdl);
+        if( ID_PollExpired( job ) ){
+            STAT( mcrwHdl->stat.timeouts++ );
+            rv = _awerror( mcrwHdl, job, job->state == AW_ERASING ?
+                           MCRW_ERR_ERASE : MCRW_ERR_WRITE );
+        }
+        else {
+            STAT( mcrwHdl->stat.polls++ );
+            rv = ID_AW_BUSY;
+        }
+        break;
     }
 
-    _opcode(mcrwHdl, base,EWDS);                     /* erase disable*/
-    _deselect(mcrwHdl, base);                        /* disable      */
+    _portclose( mcrwHdl );
 
-    if((i==0) || (j==0))                    /* error ?      */
-        return MCRW_ERR_ERASE;
-    return 0;
+    return rv;
 }
 
-/******************************* m_read_loc ********************************/
-/**   Read a specified word from EEPROM at 'base'.
+/******************************* _awerror *********************************/
+/**   Abort non-blocking write: write disable, set error
  *
  *---------------------------------------------------------------------------
  *  \param mcrwHdl		\IN MCRW handle pointer
- *	\param base			\IN base address pointer
- *	\param index		\IN index to read
- *  \return   read word
+ *	\param job			\INOUT write job
+ *	\param error		\IN MCRW error code
+ *  \return   ID_AW_ERROR
  *  
- ****************************************************************************/
-static u_int16 m_read_loc(MCRW_HANDLE  *mcrwHdl, void *base, u_int8 index )	
+ ***************************************************************************/
+static int _awerror( MCRW_HANDLE *mcrwHdl, ID_AWRITE *job, int32 error )
 {
-    register u_int16    wx;                 /* data word    */
-    register int        i;                  /* counter      */
+    _opcode(mcrwHdl, EXTCODE(mcrwHdl,EWDS));         /* write disable*/
+    _deselect(mcrwHdl);
 
-    _opcode(mcrwHdl,base, (u_int8)(_READ_+index) );
-    for(wx=0, i=0; i<16; i++)
-        wx = (u_int16)((wx<<1)+_clock(mcrwHdl,base,0));
-    _deselect(mcrwHdl,base);
-
-    return(wx);
+    job->error = (int)error;
+    job->state = AW_DONE;
+    return ID_AW_ERROR;
 }
 
-/******************************* m_write_loc *******************************/
-/**   Write a specified word into EEPROM at 'base'.
+/******************************* _waitready *******************************/
+/**   Wait until the programming cycle has finished.
+ *
+ *    Same as a step of _awstep(): the EEPROM is selected again and DO
+ *    is sampled once without clocking (low=busy, high=ready), no busy
+ *    sample is required. Between two samples the EEPROM is deselected
+ *    and the back-off of the handle's polling configuration is waited.
+ *    The sum of the back-offs counts as programming time.
  *
  *---------------------------------------------------------------------------
  *  \param mcrwHdl		\IN MCRW handle pointer
- *	\param base			\IN base address pointer
- *	\param index		\IN index to write
- *  \param data			\IN word to write
- *  \return   readed word
+ *  \return   0=ok 1=timeout
  *  
  ***************************************************************************/
-static int m_write_loc(MCRW_HANDLE  *mcrwHdl, void *base, u_int8  index, u_int16 data )	
+static int _waitready(MCRW_HANDLE  *mcrwHdl )	
+{
+    ID_WAIT  wait;
+    int      error = 1;
+
+    ID_WaitStart( mcrwHdl->osHdl, &mcrwHdl->poll, &wait );
+
+    for(;;)
+    {
+        _select(mcrwHdl, 0);                        /* DO = ready/busy */
+        if( _sample( mcrwHdl ) ){
+            error = 0;
+            break;
+        }
+        _deselect(mcrwHdl);
+        if( ID_WaitNext( &wait ) )
+            break;
+    }
+    _deselect(mcrwHdl);
+
+#ifndef ID_NO_STATS
+    mcrwHdl->stat.polls   += wait.count;
+    mcrwHdl->stat.delayUs += wait.waitedUs;
+    if( error )
+        mcrwHdl->stat.timeouts++;
+    else if( wait.waitedUs > mcrwHdl->stat.progMaxUs )
+        mcrwHdl->stat.progMaxUs = wait.waitedUs;
+#endif
+    return error;
+}
+
+/******************************* m_read_loc ********************************/
+/**   Read a specified word from EEPROM at 'base'.
+ *
+ *---------------------------------------------------------------------------
+ *  \param mcrwHdl		\IN MCRW handle pointer
+ *	\param index		\IN index to read
+ *  \return   read word
+ *  
+ ****************************************************************************/
+static u_int16 m_read_loc(MCRW_HANDLE  *mcrwHdl, u_int32 index )	
 {
-    if( _erase(mcrwHdl, base, index ))              /* erase cell first */
-        return( MCRW_ERR_ERASE );
+    u_int16    wx;                          /* data word    */
 
-    return _write(mcrwHdl, base, index, data );
+    _readburst(mcrwHdl, index, 1, &wx);
+
+    return(wx);
 }
 
 /*****************************  mcrwWriteEeprom  ********************************/
-/**   Not implemented - because not tested.
+/**   Writes <size>/2 words to EEPROM.
  *
+ *    Erase/write is enabled once for all words (see _writesession()).
+ *    With the ID_WF_DIFF write flag only differing words are programmed;
+ *    MCRW_IOCTL_WRITTEN returns their number.
  *
  *---------------------------------------------------------------------------
  *  \param mcrwHdl		\IN MCRW handle pointer
@@ -387,8 +924,38 @@ static int m_write_loc(MCRW_HANDLE  *mcrwHdl, void *base, u_int8  index, u_int16
  ****************************************************************************/
 static int32 mcrwWriteEeprom( MCRW_HANDLE *mcrwHdl, u_int8 addr, u_int16 *buf, u_int16 size )
 {
+	/*--------------------+
+	| parameter checking  |
+	+--------------------*/
+	/* check addr is multiple of 2 and not to big */
+	if( addr%2 || addr > 0xFE )
+		return( MCRW_ERR_ADDR );
+	/* check size is multiple of 2 and not to big */
+	if( size%2 || size > 0x100 || (addr+size) > 0x100 )
+		return( MCRW_ERR_BUF_SIZE );
+
+	return( MCRW_PORT_WriteEepromX( mcrwHdl, addr, buf, size ) );
+}/*mcrwWriteEeprom*/
+
+/*****************************  MCRW_PORT_WriteEepromX  ************************/
+/**   Writes <size>/2 words to EEPROM, wide address and size.
+ *
+ *    Same as mcrwWriteEeprom() for the whole device of up to 4 KB
+ *    (addrLength 6..11).
+ *
+ *---------------------------------------------------------------------------
+ *  \param hdl			\IN MCRW handle pointer
+ *	\param addr			\IN byte address (must be word aligned)
+ *	\param buf			\IN write buffer (must be word aligned)
+ *  \param size			\IN in byte must be multiple of 2,
+ *                         addr+size max. device size (2 << addrLength)
+ *  \return   0 or error code
+ *	
+ ****************************************************************************/
+int32 MCRW_PORT_WriteEepromX( void *hdl, u_int32 addr, u_int16 *buf, u_int32 size )
+{
+MCRW_HANDLE *mcrwHdl = (MCRW_HANDLE*)hdl;
 int32 error;
-int   wordCount;
 
 	/*--------------------+
 	| parameter checking  |
@@ -396,28 +963,117 @@ int   wordCount;
 	/* check buffer is word aligned */
 	if( (INT32_OR_64)buf%2 )
 		return( MCRW_ERR_BUF );
-	/* check addr is multiple of 2 and not to big */
-	if( addr%2 || addr > 0xFE )
+	/* check addr is multiple of 2 and inside the device */
+	if( addr%2 || addr >= DEV_SIZE(mcrwHdl) )
 		return( MCRW_ERR_ADDR );
 	/* check size is multiple of 2 and not to big */
-	if( size%2 || size > 0x100 || (addr+size) > 0x100 )
+	if( size%2 || size > DEV_SIZE(mcrwHdl) - addr )
 		return( MCRW_ERR_BUF_SIZE );
 
-	addr = addr/2;
+	/*--------------------------+
+	| write all in one session  |
+	+--------------------------*/
+	_portopen( mcrwHdl );
+	error = _writesession( mcrwHdl, addr/2, (int)(size/2), buf );
+	_portclose( mcrwHdl );
+	STAT( mcrwHdl->stat.wordsWritten += mcrwHdl->written );
 
-	/*-----------+
-	| read loop  |
-	+-----------*/
-	for( wordCount=0; wordCount<(size/2); wordCount++ )
-	{
-		 error = m_write_loc( mcrwHdl, mcrwHdl->desc.addrDataIn,
-						  (u_int8)(addr+wordCount), *buf++ );
-		 if( error )
-		 	return( error );
-	}/*for*/
+	return( error );
+}/*MCRW_PORT_WriteEepromX*/
+
+/*****************************  MCRW_PORT_WriteAll  ****************************/
+/**   Programs the whole EEPROM using ERAL/WRAL.
+ *
+ *    The device is erased in one cycle, a dominant fill value is written
+ *    with WRAL, then only the differing words are programmed.
+ *
+ *---------------------------------------------------------------------------
+ *  \param hdl			\IN MCRW handle pointer
+ *	\param buf			\IN image (must be word aligned)
+ *  \param size			\IN in byte, must be the device size
+ *                         (2 << addrLength)
+ *  \return   0 or error code
+ *	
+ ****************************************************************************/
+int32 MCRW_PORT_WriteAll( void *hdl, u_int16 *buf, u_int32 size )
+{
+MCRW_HANDLE *mcrwHdl = (MCRW_HANDLE*)hdl;
+int32 error;
+
+	/*--------------------+
+	| parameter checking  |
+	+--------------------*/
+	if( (INT32_OR_64)buf%2 )
+		return( MCRW_ERR_BUF );
+	if( size != DEV_SIZE(mcrwHdl) )
+		return( MCRW_ERR_BUF_SIZE );
+
+	_portopen( mcrwHdl );
+	error = _writeall( mcrwHdl, buf, (int)(size/2) );
+	_portclose( mcrwHdl );
+	STAT( mcrwHdl->stat.wordsWritten += mcrwHdl->written );
+
+	return( error );
+}/*MCRW_PORT_WriteAll*/
+
+/*****************************  MCRW_PORT_WriteStart  **************************/
+/**   Starts a non-blocking write of <size>/2 words.
+ *
+ *    Same as MCRW_PORT_WriteEepromX() (write flags and ready polling of
+ *    the handle), but the function returns as soon as the first
+ *    programming cycle has been started. The job is advanced with
+ *    ID_WriteStep() until it returns ID_AW_DONE or ID_AW_ERROR
+ *    (job->error: MCRW error code). Other accesses to the EEPROM are not
+ *    allowed until the job has finished.
+ *
+ *---------------------------------------------------------------------------
+ *	\param job			\OUT write job
+ *  \param hdl			\IN MCRW handle pointer
+ *	\param addr			\IN byte address (must be word aligned)
+ *	\param buf			\IN write buffer, must be kept until the job
+ *                         has finished
+ *  \param size			\IN in byte must be multiple of 2
+ *  \return   0 or error code
+ *	
+ ****************************************************************************/
+int32 MCRW_PORT_WriteStart( ID_AWRITE *job, void *hdl, u_int32 addr,
+                            u_int16 *buf, u_int32 size )
+{
+MCRW_HANDLE *mcrwHdl = (MCRW_HANDLE*)hdl;
+
+	/*--------------------+
+	| parameter checking  |
+	+--------------------*/
+	if( (INT32_OR_64)buf%2 )
+		return( MCRW_ERR_BUF );
+	if( addr%2 || addr >= DEV_SIZE(mcrwHdl) )
+		return( MCRW_ERR_ADDR );
+	if( size == 0 || size%2 || size > DEV_SIZE(mcrwHdl) - addr )
+		return( MCRW_ERR_BUF_SIZE );
+
+	job->step    = _awstep;
+	job->osHdl   = mcrwHdl->osHdl;
+	job->hdl     = mcrwHdl;
+	job->base    = 0;
+	job->buff    = buf;
+	job->index   = addr/2;
+	job->count   = size/2;
+	job->flags   = mcrwHdl->writeFlags;
+	job->state   = AW_NEXT;
+	job->polls   = 0;
+	job->written = 0;
+	job->pollUs  = 0;
+	job->error   = MCRW_ERR_NO;
+
+	_portopen( mcrwHdl );
+	_opcode(mcrwHdl, EXTCODE(mcrwHdl,EWEN));        /* write enable */
+	_deselect(mcrwHdl);
+	_portclose( mcrwHdl );
+
+	_awstep( job );                                 /* start first word */
 
 	return( MCRW_ERR_NO );
-}/*mcrwWriteEeprom*/
+}/*MCRW_PORT_WriteStart*/
 
 /*****************************  mcrwReadEeprom  ********************************/
 /**   Reads <size>/2 words from EEPROM.
@@ -435,14 +1091,9 @@ int   wordCount;
  ****************************************************************************/
 static int32 mcrwReadEeprom( MCRW_HANDLE *mcrwHdl, u_int8 addr, u_int16 *buf, u_int16 size )
 {
-int wordCount;
-
 	/*--------------------+
 	| parameter checking  |
 	+--------------------*/
-	/* check buffer is word aligned */
-	if( (INT32_OR_64)buf%2 )
-		return( MCRW_ERR_BUF );
 	/* check addr is multiple of 2 and not to big */
 	if( addr%2 || addr > 0xFE )
 		return( MCRW_ERR_ADDR );
@@ -450,24 +1101,70 @@ int wordCount;
 	if( size%2 || size > 0x100 || (addr+size) > 0x100 )
 		return( MCRW_ERR_BUF_SIZE );
 
-	addr = addr/2;
+	return( MCRW_PORT_ReadEepromX( mcrwHdl, addr, buf, size ) );
+}/*mcrwReadEeprom*/
 
-	/*-----------+
-	| read loop  |
-	+-----------*/
-	for( wordCount=0; wordCount<(size/2); wordCount++ )
-	{
-		*buf++ = m_read_loc( mcrwHdl, mcrwHdl->desc.addrDataIn,
-						(u_int8)(addr+wordCount) );
-	}/*for*/
+/*****************************  MCRW_PORT_ReadEepromX  *************************/
+/**   Reads <size>/2 words from EEPROM, wide address and size.
+ *
+ *    Same as mcrwReadEeprom() for the whole device of up to 4 KB
+ *    (addrLength 6..11). All words are read in one burst.
+ *
+ *---------------------------------------------------------------------------
+ *  \param hdl			\IN MCRW handle pointer
+ *	\param addr			\IN byte address (must be multiple of 2)
+ *	\param buf			\IN read buffer (must be word aligned)
+ *  \param size			\IN in byte (must be multiple of 2),
+ *                         addr+size max. device size (2 << addrLength)
+ *  \return   0 or error code
+ *	
+ ****************************************************************************/
+int32 MCRW_PORT_ReadEepromX( void *hdl, u_int32 addr, u_int16 *buf, u_int32 size )
+{
+MCRW_HANDLE *mcrwHdl = (MCRW_HANDLE*)hdl;
+
+	/*--------------------+
+	| parameter checking  |
+	+--------------------*/
+	/* check buffer is word aligned */
+	if( (INT32_OR_64)buf%2 )
+		return( MCRW_ERR_BUF );
+	/* check addr is multiple of 2 and inside the device */
+	if( addr%2 || addr >= DEV_SIZE(mcrwHdl) )
+		return( MCRW_ERR_ADDR );
+	/* check size is multiple of 2 and not to big */
+	if( size%2 || size > DEV_SIZE(mcrwHdl) - addr )
+		return( MCRW_ERR_BUF_SIZE );
+
+	/*-------------+
+	| burst read   |
+	+-------------*/
+	if( size ){
+		_portopen( mcrwHdl );
+		_readburst( mcrwHdl, addr/2, (int)(size/2), buf );
+		_portclose( mcrwHdl );
+		STAT( mcrwHdl->stat.wordsRead += size/2 );
+	}
 
 	return( MCRW_ERR_NO );
-}/*mcrwReadEeprom*/
+}/*MCRW_PORT_ReadEepromX*/
 
 
 /*****************************  mcrwGetStat  ********************************/
-/**   Getstat - not supported.
+/**   Getstat.
  *
+ *		   Note:  supported codes \n
+ *					MCRW_IOCTL_WRITE_FLAGS  - ID_WF_xxx write flags\n
+ *					MCRW_IOCTL_POLL_TIMEOUT - ready polling timeout [us]\n
+ *					MCRW_IOCTL_POLL_MIN     - first polling back-off [us]\n
+ *					MCRW_IOCTL_POLL_MAX     - max. polling back-off [us]\n
+ *					MCRW_IOCTL_POLL_FLAGS   - ID_POLL_xxx flags\n
+ *					MCRW_IOCTL_WRITTEN      - words programmed by last write\n
+ *					MCRW_IOCTL_BUS_WRITES   - register writes of last access\n
+ *					MCRW_IOCTL_BUS_CLOCK    - effective bus clock [kHz]\n
+ *					MCRW_IOCTL_ADDR_LENGTH  - address bits\n
+ *					MCRW_IOCTL_STAT_xxx     - performance counters
+ *					                          (not with ID_NO_STATS)
  *
  *---------------------------------------------------------------------------
  *  \param mcrwHdl		\IN MCRW handle pointer
@@ -479,11 +1176,86 @@ int wordCount;
  ****************************************************************************/
 static int32 mcrwGetStat( MCRW_HANDLE *mcrwHdl, int32 code,  int32 *dataP )
 {
-	return( MCRW_ERR_UNK_CODE );
+	switch( code )
+	{
+		case MCRW_IOCTL_WRITE_FLAGS:
+			*dataP = (int32)mcrwHdl->writeFlags;
+			break;
+		case MCRW_IOCTL_POLL_TIMEOUT:
+			*dataP = (int32)mcrwHdl->poll.timeoutUs;
+			break;
+		case MCRW_IOCTL_POLL_MIN:
+			*dataP = (int32)mcrwHdl->poll.minUs;
+			break;
+		case MCRW_IOCTL_POLL_MAX:
+			*dataP = (int32)mcrwHdl->poll.maxUs;
+			break;
+		case MCRW_IOCTL_POLL_FLAGS:
+			*dataP = (int32)mcrwHdl->poll.flags;
+			break;
+		case MCRW_IOCTL_WRITTEN:
+			*dataP = (int32)mcrwHdl->written;
+			break;
+		case MCRW_IOCTL_BUS_WRITES:
+			*dataP = (int32)mcrwHdl->lastWrites;
+			break;
+		case MCRW_IOCTL_BUS_CLOCK:
+			/* effective clock of the rounded half period */
+			*dataP = mcrwHdl->halfNs ?
+				(int32)((500000 + mcrwHdl->halfNs/2) / mcrwHdl->halfNs) : 0;
+			break;
+		case MCRW_IOCTL_ADDR_LENGTH:
+			*dataP = (int32)mcrwHdl->desc.addrLength;
+			break;
+#ifndef ID_NO_STATS
+		case MCRW_IOCTL_STAT_WORDS_READ:
+			*dataP = (int32)mcrwHdl->stat.wordsRead;
+			break;
+		case MCRW_IOCTL_STAT_WORDS_WRITTEN:
+			*dataP = (int32)mcrwHdl->stat.wordsWritten;
+			break;
+		case MCRW_IOCTL_STAT_BUS_ACCESSES:
+			*dataP = (int32)mcrwHdl->stat.busAccesses;
+			break;
+		case MCRW_IOCTL_STAT_DELAY_US:
+			*dataP = (int32)mcrwHdl->stat.delayUs;
+			break;
+		case MCRW_IOCTL_STAT_POLLS:
+			*dataP = (int32)mcrwHdl->stat.polls;
+			break;
+		case MCRW_IOCTL_STAT_PROG_MAX_US:
+			*dataP = (int32)mcrwHdl->stat.progMaxUs;
+			break;
+		case MCRW_IOCTL_STAT_VERIFY_ERRS:
+			*dataP = (int32)mcrwHdl->stat.verifyErrs;
+			break;
+		case MCRW_IOCTL_STAT_TIMEOUTS:
+			*dataP = (int32)mcrwHdl->stat.timeouts;
+			break;
+#endif
+		default:
+			return( MCRW_ERR_UNK_CODE );
+	}/*switch*/
+
+	return( MCRW_ERR_NO );
 }/*mcrwGetStat*/
 /*****************************  mcrwSetStat  ********************************/
-/**   Setstat - not supported.
+/**   Setstat.
+ *
+ *		   Note:  supported codes \n
+ *					MCRW_IOCTL_WRITE_FLAGS  - ID_WF_xxx write flags\n
+ *					MCRW_IOCTL_POLL_TIMEOUT - ready polling timeout [us]\n
+ *					MCRW_IOCTL_POLL_MIN     - first polling back-off [us]\n
+ *					MCRW_IOCTL_POLL_MAX     - max. polling back-off [us]\n
+ *					MCRW_IOCTL_POLL_FLAGS   - ID_POLL_xxx flags\n
+ *					MCRW_IOCTL_BUS_CLOCK    - bus clock [kHz]
+ *					                          (0..MCRW_BUS_CLOCK_MAX)\n
+ *					MCRW_IOCTL_ADDR_LENGTH  - address bits (6..11)\n
+ *					MCRW_IOCTL_STAT_RESET   - clear performance counters
+ *					                          (not with ID_NO_STATS)
  *
+ *		   The new values are used from the next access on; the handle
+ *		   need not be reinitialized.
  *
  *---------------------------------------------------------------------------
  *  \param mcrwHdl		\IN MCRW handle pointer
@@ -494,11 +1266,53 @@ static int32 mcrwGetStat( MCRW_HANDLE *mcrwHdl, int32 code,  int32 *dataP )
  ****************************************************************************/
 static int32 mcrwSetStat( MCRW_HANDLE *mcrwHdl, int32 code,  int32 data   )
 {
-	return( MCRW_ERR_UNK_CODE );
+	switch( code )
+	{
+		case MCRW_IOCTL_WRITE_FLAGS:
+			mcrwHdl->writeFlags = (u_int32)data;
+			break;
+		case MCRW_IOCTL_POLL_TIMEOUT:
+			mcrwHdl->poll.timeoutUs = (u_int32)data;
+			break;
+		case MCRW_IOCTL_POLL_MIN:
+			mcrwHdl->poll.minUs = (u_int32)data;
+			break;
+		case MCRW_IOCTL_POLL_MAX:
+			mcrwHdl->poll.maxUs = (u_int32)data;
+			break;
+		case MCRW_IOCTL_POLL_FLAGS:
+			mcrwHdl->poll.flags = (u_int32)data;
+			break;
+		case MCRW_IOCTL_BUS_CLOCK:
+			/* desc.busClock is u_int8, the clock is kept in halfNs */
+			if( data < 0 || data > MCRW_BUS_CLOCK_MAX )
+				return( MCRW_ERR_DESCRIPTOR );
+			mcrwHdl->halfNs = halfperiod( (u_int32)data );
+			break;
+		case MCRW_IOCTL_ADDR_LENGTH:
+			if( data < ADDR_LEN_MIN || data > ADDR_LEN_MAX )
+				return( MCRW_ERR_DESCRIPTOR );
+			mcrwHdl->desc.addrLength = (u_int8)data;
+			break;
+#ifndef ID_NO_STATS
+		case MCRW_IOCTL_STAT_RESET:
+			OSS_MemFill( mcrwHdl->osHdl, sizeof(mcrwHdl->stat),
+						 (char*)&mcrwHdl->stat, 0 );
+			break;
+#endif
+		default:
+			return( MCRW_ERR_UNK_CODE );
+	}/*switch*/
+
+	return( MCRW_ERR_NO );
 }/*mcrwSetStat*/
 
 /****************************** MCRW_PORT_Init ****************************/
 /**   Initializes this library and check's the MCRW host.
+ *
+ *    descP->busClock is the max. bus clock in kHz (1..255), 0 runs
+ *    without delays. Faster clocks up to MCRW_BUS_CLOCK_MAX do not fit
+ *    into the descriptor, they are set with MCRW_IOCTL_BUS_CLOCK.
  *
  *---------------------------------------------------------------------------
  *  \param descP		\IN pointer to MCRW descriptor
@@ -524,18 +1338,8 @@ u_int32		gotSize;
 	|  check descriptor	   |
 	+---------------------*/
 	if(		/* check access size */
-		   ( descP->busClock != 0 ) 
-		&& ( descP->busClock != 1 )
-		&& ( descP->busClock != 10 )  
-	  )
-	{
-		error = MCRW_ERR_DESCRIPTOR;
-		goto CLEANUP;
-	}/*if*/
-
-	if(		/* check access size */
-		   ( descP->addrLength < 6 ) 
-		|| ( descP->addrLength > 8 ) 
+		   ( descP->addrLength < ADDR_LEN_MIN ) 
+		|| ( descP->addrLength > ADDR_LEN_MAX ) 
 	  )
 	{
 		error = MCRW_ERR_DESCRIPTOR;
@@ -577,12 +1381,15 @@ u_int32		gotSize;
 	}
 	else
 	{
-		/* on M-Modules the bits are in one register
-		   the lib is not prepared for non M-Module EEPROM interface
-		   due a lack of suitable test hardware
-		   -> the error case can be removed after preparing test */
-		error = MCRW_ERR_DESCRIPTOR;
-		goto CLEANUP;
+		/* separate registers: mapped lines, all need an address */
+		if( !( descP->flagsOut & MCRW_DESC_PORT_FLAG_OUT_MAPPED )
+			|| descP->addrDataIn == NULL || descP->addrDataOut == NULL
+			|| descP->addrClockOut == NULL || descP->addrCsOut == NULL
+		  )
+		{
+			error = MCRW_ERR_DESCRIPTOR;
+			goto CLEANUP;
+		}/*if*/
 	}/*if*/
 
 
@@ -615,17 +1422,15 @@ u_int32		gotSize;
 	mcrwHdl->desc 			    = *descP;
 	mcrwHdl->ownSize  			= gotSize;
 	mcrwHdl->osHdl    			= (OSS_HANDLE*) osHdl;
+	mcrwHdl->halfNs				= halfperiod( descP->busClock );
+	ID_PollConfigGet( &mcrwHdl->poll );
+	ID_TimeCheck( mcrwHdl->osHdl );			/* calibrate delays once */
 
-	if(	/* write registers are in one register ? */
-		( descP->flagsOut & MCRW_DESC_PORT_FLAG_OUT_IN_ONE_REG )
-	  )
+	/* precompute register accesses per line state */
+	if( (error = (u_int32)_portinit( mcrwHdl )) != MCRW_ERR_NO )
 	{
-		/* merge the out defaults, if all outs in one register */
-		mcrwHdl->desc.notReadBackDefaultsDataOut  &= mcrwHdl->desc.notReadBackDefaultsClockOut;
-		mcrwHdl->desc.notReadBackDefaultsDataOut  &= mcrwHdl->desc.notReadBackDefaultsCsOut;
-		mcrwHdl->desc.notReadBackDefaultsClockOut = mcrwHdl->desc.notReadBackDefaultsDataOut;
-		mcrwHdl->desc.notReadBackDefaultsCsOut    = mcrwHdl->desc.notReadBackDefaultsDataOut;
-		mcrwHdl->outDefault   = mcrwHdl->desc.notReadBackDefaultsDataOut;
+		OSS_MemFree( (OSS_HANDLE*)osHdl, mcrwHdl, gotSize );
+		goto CLEANUP;
 	}/*if*/
 
 	mcrwHdl->entries.Ident		= mcrwIdent;
@@ -671,7 +1476,3 @@ MCRW_HANDLE  *mcrwHdl;
 
 	return( error );
 }/*mcrwExit*/
-
-
-
-
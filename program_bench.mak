@@ -0,0 +1,52 @@
+#**************************  M a k e f i l e ********************************
+#
+#         Author: kp
+#
+#    Description: makefile descriptor for ID library benchmark
+#
+#                 host program, runs the read/write functions on the
+#                 simulated EEPROMs of the id_sim library variant.
+#                 Regression check against the reference output:
+#                   id_bench -r=id_bench.ref   (exit code 1 on regression)
+#
+#                 NOTE: this is an MDIS makefile descriptor, it only
+#                 defines what to build. The MDIS build cannot run the
+#                 program, so a cycle-count regression does NOT fail the
+#                 build by itself. The check above must be run as a
+#                 separate step after the build (e.g. in the release or
+#                 CI script) and its exit code evaluated there.
+#
+#-----------------------------------------------------------------------------
+#   Copyright 1999-2019, MEN Mikro Elektronik GmbH
+#*****************************************************************************
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+MAK_NAME=id_bench
+
+MAK_LIBS=$(LIB_PREFIX)$(MEN_LIB_DIR)/id_sim$(LIB_SUFFIX)
+
+MAK_SWITCH=$(SW_PREFIX)ID_SIM \
+		   $(SW_PREFIX)MAC_MEM_MAPPED
+
+MAK_INCL=$(MEN_MOD_DIR)/id_ext.h \
+         $(MEN_MOD_DIR)/id_sim.h \
+         $(MEN_INC_DIR)/men_typs.h \
+         $(MEN_INC_DIR)/oss.h \
+         $(MEN_INC_DIR)/modcom.h \
+         $(MEN_INC_DIR)/microwire.h
+
+MAK_INP1=id_bench$(INP_SUFFIX)
+
+MAK_INP=$(MAK_INP1)
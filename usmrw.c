@@ -16,7 +16,14 @@
  * int usm_mread(addr,buff)            multiple read i=0..128
  * int usm_mwrite(addr,buff)           multiple write i=0..128
  * int usm_read(addr,index)            single read i
+ * int usm_readburst(base,index,       sequential read of a word range
+ *                   count,buff)
  * int usm_write(addr,index,data)      single write i
+ * int usm_writerange(addr,index,      write a word range
+ *                    count,buff,
+ *                    flags,writtenP)
+ * int usm_writestart(job,addr,index,  start non-blocking write of a word
+ *                    count,buff,flags) range (see ID_WriteStep())
  *
  *
  *
@@ -52,6 +59,8 @@
 #include <MEN/oss.h>
 #include <MEN/maccess.h>
 #include <MEN/modcom.h>
+#include "id_ext.h"
+#include "id_int.h"
 
 static const char IdentString[]=MENT_XSTR(MAK_REVISION);
 
@@ -59,8 +68,6 @@ static const char IdentString[]=MENT_XSTR(MAK_REVISION);
 |   DEFINES                             |
 +--------------------------------------*/
 
-#define DELAY   		60    	/* usm_clock's delay time */
-
 /* id defines */
 #define USM_ID_MAGIC	0x5553  /* USM id prom magic word */
 
@@ -73,9 +80,36 @@ static const char IdentString[]=MENT_XSTR(MAK_REVISION);
 #define B_CLK			0x10	/* clock				*/
 #define B_SEL			0x20	/* chip-select			*/
 
+/* waveform of one bit after bit <l>: clock low with old data, clock
+   low with new data (skipped if unchanged), clock high (see _clockout()) */
+#define W_SKIP			0xff
+#define W_BIT(l,d)		((l)<<3)|B_SEL, ((l)==(d) ? W_SKIP : ((d)<<3)|B_SEL), \
+						((d)<<3)|B_CLK|B_SEL
+#define W_NIB(l,n)		{ W_BIT((l),((n)>>3)&1), W_BIT(((n)>>3)&1,((n)>>2)&1), \
+						  W_BIT(((n)>>2)&1,((n)>>1)&1), W_BIT(((n)>>1)&1,(n)&1) }
+#define W_ROW(l)		{ W_NIB(l,0x0), W_NIB(l,0x1), W_NIB(l,0x2), W_NIB(l,0x3), \
+						  W_NIB(l,0x4), W_NIB(l,0x5), W_NIB(l,0x6), W_NIB(l,0x7), \
+						  W_NIB(l,0x8), W_NIB(l,0x9), W_NIB(l,0xa), W_NIB(l,0xb), \
+						  W_NIB(l,0xc), W_NIB(l,0xd), W_NIB(l,0xe), W_NIB(l,0xf) }
+
+/* page write */
+#define USM_PAGE_WORDS	4		/* words per page (8 byte page) */
+
+/* non-blocking write (ID_AWRITE.state) */
+#define AW_NEXT			0		/* write next word		*/
+#define AW_POLL			1		/* acknowledge polling	*/
+#define AW_DONE			2		/* finished				*/
+
 /* A08 register address */
 #define MODREG  		0xfe	/* ID-Register for M-Module and USM */
 
+/*--------------------------------------+
+|   STATICS                             |
++--------------------------------------*/
+/* line states of the 4 bits of a nibble (MSB first) after a previous
+   data bit 0/1, see _byteout() */
+static const u_int8 G_usmWave[2][16][12] = { W_ROW(0), W_ROW(1) };
+
 /*--------------------------------------+
 |   PROTOTYPES                          |
 +--------------------------------------*/
@@ -83,12 +117,24 @@ int usm_mread( u_int8   *addr, u_int16  *buff );
 int usm_mwrite( u_int8  *addr, u_int16 *buff );
 int usm_write( u_int8 *addr, u_int8  index, u_int16 data );
 int usm_read( U_INT32_OR_64 base, u_int8 index );
-static void _opcode( U_INT32_OR_64 base, u_int8 code );
-static void _start( U_INT32_OR_64 base );
-static void _stop( U_INT32_OR_64 base );
-static void _select( U_INT32_OR_64 base );
-static void _deselect( U_INT32_OR_64 base );
-static int  _clock( U_INT32_OR_64 base, u_int8 dbs , u_int8 lastdbs);
+int usm_readburst( U_INT32_OR_64 base, u_int8 index, u_int8 count, u_int16 *buff );
+int usm_writerange( u_int8 *addr, u_int8 index, u_int8 count, u_int16 *buff,
+                    u_int32 flags, u_int32 *writtenP );
+static int  _readseq( ID_BUS *bus, u_int8 index, u_int8 count, u_int16 *buff );
+static int  _writeword( ID_BUS *bus, u_int8 index, u_int16 data );
+static void _byteout( ID_BUS *bus, u_int8 byte, u_int8 lastdbs );
+static int  _writepage( ID_BUS *bus, u_int8 index, u_int8 count,
+                        u_int16 *buff );
+static int  _ackpoll( ID_BUS *bus );
+static int  _ackwait( ID_BUS *bus );
+static int  _ustep( ID_AWRITE *job );
+static void _opcode( ID_BUS *bus, u_int8 code );
+static void _start( ID_BUS *bus );
+static void _stop( ID_BUS *bus );
+static void _select( ID_BUS *bus );
+static void _deselect( ID_BUS *bus );
+static void _clockout( ID_BUS *bus, u_int8 dbs , u_int8 lastdbs);
+static int  _clock( ID_BUS *bus, u_int8 dbs , u_int8 lastdbs);
 static void _delay( void );
 
 /******************************* usm_mread ************************************/
@@ -102,16 +148,50 @@ static void _delay( void );
  ******************************************************************************/
 int usm_mread( u_int8   *addr, u_int16  *buff )
 {
+    ID_BUS     bus;
+    int        error;
 
-    register u_int8    index;
+    ID_BusOpen( &bus, (U_INT32_OR_64)addr, MODREG );
+    error = _readseq( &bus, 0, USM_EEPROM_WORDS, buff );
+    ID_BusClose( &bus );
 
-    for(index=0; index<128; index++)
-        *buff++ = (u_int16)usm_read( (U_INT32_OR_64)addr, index);
-    return 0;
+    return error ? 1 : 0;
+}
+
+/******************************* usm_readburst ********************************/
+/** Read a range of words from EEPROM at 'base' in one transaction.
+ *
+ *  The word address is sent only once; the EEPROM then increments its
+ *  address internally and the master acknowledges byte after byte until
+ *  <count> words have been read (sequential read).
+ *
+ *------------------------------------------------------------------------------
+ *  \param  base   \IN  base address pointer
+ *  \param  index  \IN  first index to read (0..127)
+ *  \param  count  \IN  number of words to read (1..128)
+ *  \param  buff   \OUT user buffer (count words)
+ *  \return 0=ok, 1..3=no acknowledge, 4=illegal range
+ *
+ ******************************************************************************/
+int usm_readburst( U_INT32_OR_64 base, u_int8 index, u_int8 count, u_int16 *buff )
+{
+    ID_BUS     bus;
+    int        error;
+
+    if( count == 0 || (index + count) > USM_EEPROM_WORDS )
+        return 0x4;
+
+    ID_BusOpen( &bus, base, MODREG );
+    error = _readseq( &bus, index, count, buff );
+    ID_BusClose( &bus );
+
+    return error;
 }
 
 /******************************* usm_mwrite ***********************************/
 /** Write all contents (words 0..128) into EEPROM at 'base'.
+ *
+ *  The EEPROM is written page by page (see usm_writerange()).
  *
  *------------------------------------------------------------------------------
  *  \param addr   \IN base address pointer
@@ -121,14 +201,226 @@ int usm_mread( u_int8   *addr, u_int16  *buff )
  ******************************************************************************/
 int usm_mwrite( u_int8  *addr, u_int16 *buff )
 {
-    register u_int8    index;
+    if( usm_writerange( addr, 0, USM_EEPROM_WORDS, buff, 0, NULL ) )
+        return 1;
+    return 0;
+}
+
+/******************************* usm_writerange *******************************/
+/** Write a range of words into EEPROM at 'base'.
+ *
+ *  The words are written in page mode: one transaction per EEPROM page
+ *  (USM_PAGE_WORDS words), then the end of the internal write cycle is
+ *  detected by acknowledge polling before the next page is sent.
+ *
+ *  With ID_WF_DIFF the range is read first with one sequential read
+ *  and only the words that differ from the buffer are written; within
+ *  a page the words from the first to the last differing one are sent
+ *  (unchanged words inside that span are rewritten with their current
+ *  value and not counted in *writtenP).
+ *
+ *------------------------------------------------------------------------------
+ *  \param addr      \IN  base address pointer
+ *  \param index     \IN  first index to write (0..127)
+ *  \param count     \IN  number of words to write (1..128)
+ *  \param buff      \IN  user buffer (count words)
+ *  \param flags     \IN  write flags (ID_WF_xxx)
+ *  \param writtenP  \OUT number of changed words written (may be NULL)
+ *  \return 0=OK, 1..4=write error (not acknowledged: 1=control byte,
+ *          2=word address, 3/4=data), 5=read error, 6=illegal range,
+ *          7=write cycle timeout (no acknowledge after the page)
+ *
+ ******************************************************************************/
+int usm_writerange( u_int8 *addr, u_int8 index, u_int8 count, u_int16 *buff,
+                    u_int32 flags, u_int32 *writtenP )
+{
+    u_int16    cur[USM_EEPROM_WORDS];		/* current contents		*/
+    u_int32    written = 0;
+    u_int8     n, end, first, last, i;
+    int        error = 0;
+    ID_BUS     bus;
+
+    if( count == 0 || (index + count) > USM_EEPROM_WORDS ){
+        error = 0x6;
+        goto DONE;
+    }
+
+    ID_BusOpen( &bus, (U_INT32_OR_64)addr, MODREG );
+
+    if( (flags & ID_WF_DIFF) &&
+        _readseq( &bus, index, count, cur ) ){
+        error = 0x5;
+        goto CLOSE;
+    }
+
+    for( n=0; n<count; n=end )
+    {
+        /* words up to the end of the page */
+        end = (u_int8)(n + USM_PAGE_WORDS - (index+n) % USM_PAGE_WORDS);
+        if( end > count )
+            end = count;
+
+        first = n;
+        last  = end;
+        if( flags & ID_WF_DIFF ){
+            while( first < last && cur[first] == buff[first] )
+                first++;						/* already there		*/
+            while( last > first && cur[last-1] == buff[last-1] )
+                last--;
+            if( first == last )
+                continue;
+        }
+
+        if( (error = _writepage( &bus, (u_int8)(index+first),
+                                 (u_int8)(last-first), &buff[first] )) != 0 )
+            break;
+        for( i=first; i<last; i++ )
+            if( !(flags & ID_WF_DIFF) || cur[i] != buff[i] )
+                written++;
+
+        if( _ackwait( &bus ) ){					/* write cycle			*/
+            error = 0x7;
+            break;
+        }
+    }
+
+CLOSE:
+    ID_BusClose( &bus );
+
+DONE:
+    if( writtenP )
+        *writtenP = written;
+
+    return error;
+}
+
+
+/******************************* usm_writestart *******************************/
+/** Start a non-blocking write of a word range
+ *
+ *  Same as usm_writerange(), but the function returns as soon as the
+ *  first word has been sent. The end of the internal write cycle is
+ *  detected by acknowledge polling: the device address is not
+ *  acknowledged while the EEPROM is busy. The job is advanced with
+ *  ID_WriteStep() until it returns ID_AW_DONE or ID_AW_ERROR
+ *  (job->error: 1..4=write error, 5=read error, 7=write cycle
+ *  timeout).
+ *
+ *------------------------------------------------------------------------------
+ *  \param job    \OUT write job
+ *  \param addr   \IN  base address pointer
+ *  \param index  \IN  first index to write (0..127)
+ *  \param count  \IN  number of words to write (1..128)
+ *  \param buff   \IN  user buffer (count words), must be kept until the
+ *                      job has finished
+ *  \param flags  \IN  write flags (ID_WF_xxx)
+ *  \return 0=OK, 6=illegal range
+ *
+ ******************************************************************************/
+int usm_writestart( ID_AWRITE *job, u_int8 *addr, u_int8 index, u_int8 count,
+                    u_int16 *buff, u_int32 flags )
+{
+    if( count == 0 || (index + count) > USM_EEPROM_WORDS )
+        return 0x6;
+
+    job->step    = _ustep;
+    job->osHdl   = NULL;
+    job->hdl     = NULL;
+    job->base    = (U_INT32_OR_64)addr;
+    job->buff    = buff;
+    job->index   = index;
+    job->count   = count;
+    job->flags   = flags;
+    job->state   = AW_NEXT;
+    job->polls   = 0;
+    job->written = 0;
+    job->pollUs  = 0;
+    job->error   = 0;
+
+    _ustep( job );								/* send first word		*/
 
-    for(index=0; index<128; index++)
-        if( usm_write(addr,index,*buff++) )
-            return 1;
     return 0;
 }
 
+/******************************* _ustep ***************************************/
+/** ID_WriteStep() of usm_writestart() jobs
+ *
+ *------------------------------------------------------------------------------
+ *  \param job    \INOUT write job
+ *  \return ID_AW_xxx
+ *
+ ******************************************************************************/
+static int _ustep( ID_AWRITE *job )
+{
+    u_int16    rd;
+    int        rv = ID_AW_BUSY;
+    ID_BUS     bus;
+
+    if( job->state == AW_DONE )
+        return job->error ? ID_AW_ERROR : ID_AW_DONE;
+
+    ID_BusOpen( &bus, job->base, MODREG );
+
+    while( rv == ID_AW_BUSY )
+    {
+        if( job->state == AW_POLL ){
+            if( !_ackpoll( &bus ) ){			/* still busy			*/
+                if( ID_PollExpired( job ) ){
+                    job->error = 0x7;
+                    job->state = AW_DONE;
+                }
+                else
+                    break;
+            }
+            else {
+                job->written++;
+                job->index++;
+                job->buff++;
+                job->count--;
+                job->state = AW_NEXT;
+            }
+        }
+
+        if( job->state == AW_NEXT ){
+            if( job->count == 0 ){
+                job->state = AW_DONE;
+                continue;
+            }
+
+            if( job->flags & ID_WF_DIFF ){
+                if( _readseq( &bus, (u_int8)job->index, 1, &rd ) ){
+                    job->error = 0x5;
+                    job->state = AW_DONE;
+                    continue;
+                }
+                if( rd == *job->buff ){			/* already there		*/
+                    job->index++;
+                    job->buff++;
+                    job->count--;
+                    continue;
+                }
+            }
+
+            if( (job->error = _writeword( &bus, (u_int8)job->index,
+                                          *job->buff )) != 0 ){
+                _stop( &bus );
+                _deselect( &bus );
+                job->state = AW_DONE;
+                continue;
+            }
+            job->state = AW_POLL;
+            ID_PollStart( job, NULL );
+            break;
+        }
+
+        if( job->state == AW_DONE )
+            rv = job->error ? ID_AW_ERROR : ID_AW_DONE;
+    }
+
+    ID_BusClose( &bus );
+
+    return rv;
+}
 
 /******************************* usm_write ************************************/
 /** Write a specified word into EEPROM at 'base'.
@@ -142,36 +434,14 @@ int usm_mwrite( u_int8  *addr, u_int16 *buff )
  ******************************************************************************/
 int usm_write( u_int8 *addr, u_int8  index, u_int16 data )
 {
-    register int        i;                  		/* counter      		*/
-	register u_int8 	offset;						/* offset of the data 	*/
-
-	offset = index *2;								/* word size			*/
+    ID_BUS     bus;
+    int        error;
 
-  	_select((U_INT32_OR_64)addr);							/* select B_SEL line 	*/
-    _start((U_INT32_OR_64)addr);							/* start condition 		*/
-   	_opcode((U_INT32_OR_64) addr, (u_int8)(_WRITE_USM) );	/* opcode for write		*/
-	if(	_clock((U_INT32_OR_64)addr, 0,0) != 0)			/* wait for acknowledge */
-   		return 0x1;
-	/* write address */
-	for( i=7; i>=0; i-- )							/* send address 		*/
+    ID_BusOpen( &bus, (U_INT32_OR_64)addr, MODREG );
+    error = _writeword( &bus, index, data );
+    ID_BusClose( &bus );
 
-	_clock((U_INT32_OR_64)addr,(u_int8)((offset>>i)&0x01),(u_int8)((offset>>(i+1))&0x01));
- 	if (_clock((U_INT32_OR_64)addr, 1 ,(u_int8)(offset&0x01))!= 0)	/* wait for acknowledge */
-  		return 0x2;
-	/* send first byte of the word */
-    for( i=15; i>=8; i--)							/* send data at address */
-  		_clock((U_INT32_OR_64)addr, (u_int8)((data>>i)&0x01),(u_int8)((data>>(i+1))&0x01));
-	if(_clock((U_INT32_OR_64)addr,1,(u_int8)(data&0x01)) != 0)		/* wait for acknowledge */
-		return 0x3;
-	/* send second byte of the word */
-	for( i=7; i>=0; i--)							/* send data at address */
- 		_clock((U_INT32_OR_64)addr, (u_int8)((data>>i)&0x01),(u_int8)((data>>(i+1))&0x01));
-	if(_clock((U_INT32_OR_64)addr,1,(u_int8)(data&0x01)) != 0)		/* wait for acknowledge */
-		return 0x4;
-	_stop((U_INT32_OR_64)addr);							/* stop condition 		*/
-  	_deselect((U_INT32_OR_64)addr);						/* deselect B_SEL line 	*/
-
-	return 0x0;
+    return error;
 }
 
 /******************************* usm_read *************************************/
@@ -184,42 +454,232 @@ int usm_write( u_int8 *addr, u_int8  index, u_int16 data )
  *
  ******************************************************************************/
 int usm_read( U_INT32_OR_64 base, u_int8 index )
+{
+    u_int16    wx;                          /* data word    				*/
+    int        error;
+    ID_BUS     bus;
+
+    ID_BusOpen( &bus, base, MODREG );
+    error = _readseq( &bus, index, 1, &wx );
+    ID_BusClose( &bus );
+
+    if( error )
+        return error;
+
+ return(wx);
+}
+
+/******************************* _readseq *************************************/
+/** Sequential read of <count> words starting at <index>
+ *
+ *  Dummy write of the start address, repeated start, then all data bytes
+ *  are read in one transfer. Every byte except the last one is
+ *  acknowledged by the master.
+ *
+ *------------------------------------------------------------------------------
+ *  \param  base   \IN  base address pointer
+ *  \param  index  \IN  first index to read (0..127)
+ *  \param  count  \IN  number of words to read
+ *  \param  buff   \OUT user buffer (count words)
+ *  \return 0=ok, 1..3=no acknowledge
+ *
+ ******************************************************************************/
+static int _readseq( ID_BUS *bus, u_int8 index, u_int8 count, u_int16 *buff )
 {
     register u_int16    wx;                 /* data word    				*/
     register int        i;                  /* counter      				*/
 	register u_int8 	offset;				/* offet of the data 			*/
+	int					error = 0;
+
+	offset = (u_int8)(index *2);			/* word size					*/
+
+   	_select(bus);							/* select B_SEL line 			*/
+    _start(bus);							/* start condition 				*/
+  	_opcode(bus, (u_int8)(_WRITE_USM) );	/* opcode for write 			*/
+	if (_clock(bus, 1,0)!= 0){				/* wait for acknowledge 		*/
+		error = 0x1;
+		goto ABORT;
+	}
+
+	_byteout(bus, offset, 1);				/* send address to be read from */
+	if( _clock(bus,1,(u_int8)(offset&0x01)) != 0){	/* wait for acknowledge */
+		error = 0x2;
+		goto ABORT;
+	}
+ 	_start(bus);							/* start condition 				*/
+  	_opcode(bus, (u_int8)(_READ_USM) );	/* opcode for read 				*/
+	if( _clock(bus,1,1)!= 0){				/* wait for acknowledge 		*/
+		error = 0x3;
+		goto ABORT;
+	}
+
+	while( count-- )
+	{
+		/* read first byte of the word */
+	    for(wx=0, i=0; i<8; i++)			/* read EEPROM data 			*/
+	  		wx = (u_int16)((wx<<1)+_clock(bus,1,1));
+		_clockout(bus,0,0);					/* set acknowledge 				*/
+
+		/* read second byte of the word */
+	    for(i=0; i<8; i++)					/* read EEPROM data 			*/
+	  		wx = (u_int16)((wx<<1)+_clock(bus,1,1));
+		if( count )
+			_clockout(bus,0,0);				/* set acknowledge 				*/
+		else
+			_clockout(bus,1,1);				/* no acknowledge 				*/
+
+		*buff++ = wx;
+	}
+
+ABORT:
+   	_stop(bus);							/* stop condition 				*/
+ 	_deselect(bus);						/* deselect B_SEL line 			*/
+
+	return error;
+}
 
-	offset = index *2;						/* word size					*/
+/******************************* _writeword ***********************************/
+/** Write one word at <index>
+ *
+ *------------------------------------------------------------------------------
+ *  \param  bus    \IN bus access context
+ *  \param  index  \IN index to write (0..127)
+ *  \param  data   \IN word to write
+ *  \return 0=OK, 1..4=no acknowledge
+ *
+ ******************************************************************************/
+static int _writeword( ID_BUS *bus, u_int8 index, u_int16 data )
+{
+	register u_int8 	offset;						/* offset of the data 	*/
 
-   	_select(base);							/* select B_SEL line 			*/
-    _start(base);							/* start condition 				*/
-  	_opcode(base, (u_int8)(_WRITE_USM) );	/* opcode for write 			*/
-	if (_clock(base, 1,0)!= 0)				/* wait for acknowledge 		*/
-		return 0x1;
+	offset = index *2;								/* word size			*/
 
+  	_select(bus);									/* select B_SEL line 	*/
+    _start(bus);									/* start condition 		*/
+   	_opcode(bus, (u_int8)(_WRITE_USM) );			/* opcode for write		*/
+	if(	_clock(bus, 0,0) != 0)						/* wait for acknowledge */
+   		return 0x1;
 	/* write address */
-	for( i=7; i>=0; i-- )					/* send address to be read from */
-  		_clock(base,(u_int8)((offset>>i)&0x01),0);
-	if( _clock(base,1,1)!= 0)				/* wait for acknowledge 		*/
-		return 0x2;
- 	_start(base);							/* start condition 				*/
-  	_opcode(base, (u_int8)(_READ_USM) );	/* opcode for read 				*/
-	if( _clock(base,1,1)!= 0)				/* wait for acknowledge 		*/
+	_byteout(bus, offset, 0);						/* send address 		*/
+ 	if (_clock(bus, 1 ,(u_int8)(offset&0x01))!= 0)	/* wait for acknowledge */
+  		return 0x2;
+	/* send first byte of the word */
+	_byteout(bus, (u_int8)(data>>8), 0);			/* send data at address */
+	if(_clock(bus,1,(u_int8)(data&0x01)) != 0)		/* wait for acknowledge */
 		return 0x3;
+	/* send second byte of the word */
+	_byteout(bus, (u_int8)data, (u_int8)((data>>8)&0x01)); /* send data */
+	if(_clock(bus,1,(u_int8)(data&0x01)) != 0)		/* wait for acknowledge */
+		return 0x4;
+	_stop(bus);										/* stop condition 		*/
+  	_deselect(bus);									/* deselect B_SEL line 	*/
 
-	/* read first byte of the word */
-    for(wx=0, i=0; i<8; i++)				/* read EEPROM data 			*/
-  		wx = (u_int16)((wx<<1)+_clock(base,1,1));
-	_clock(base,0,0);						/* set acknowledge 				*/
+	return 0x0;
+}
 
-	/* read second byte of the word */
-    for(i=0; i<8; i++)						/* read EEPROM data 			*/
-  		wx = (u_int16)((wx<<1)+_clock(base,1,1));
-	_clock(base,1,1);						/* no acknowledge 				*/
-   	_stop(base);							/* stop condition 				*/
- 	_deselect(base);						/* deselect B_SEL line 			*/
+/******************************* _writepage ***********************************/
+/** Write <count> words at <index> within one EEPROM page
+ *
+ *  Start, control byte, word address, then all data bytes in one
+ *  transaction. The write cycle starts with the stop condition.
+ *
+ *------------------------------------------------------------------------------
+ *  \param  bus    \IN bus access context
+ *  \param  index  \IN first index to write (0..127)
+ *  \param  count  \IN number of words, must not cross the page
+ *  \param  buff   \IN words to write
+ *  \return 0=OK, 1..4=no acknowledge
+ *
+ ******************************************************************************/
+static int _writepage( ID_BUS *bus, u_int8 index, u_int8 count,
+                       u_int16 *buff )
+{
+	register u_int16	data;						/* data word			*/
+	register u_int8 	offset;						/* offset of the data 	*/
+	int					error = 0;
+
+	offset = (u_int8)(index *2);					/* word size			*/
+
+  	_select(bus);									/* select B_SEL line 	*/
+    _start(bus);									/* start condition 		*/
+   	_opcode(bus, (u_int8)(_WRITE_USM) );			/* opcode for write		*/
+	if(	_clock(bus,1,0) != 0){						/* wait for acknowledge */
+		error = 0x1;
+		goto ABORT;
+	}
+	_byteout(bus, offset, 1);						/* send address 		*/
+ 	if( _clock(bus,1,(u_int8)(offset&0x01)) != 0){	/* wait for acknowledge */
+		error = 0x2;
+		goto ABORT;
+	}
+
+	while( count-- )
+	{
+		data = *buff++;
+		_byteout(bus, (u_int8)(data>>8), 1);		/* send first byte		*/
+		if( _clock(bus,1,(u_int8)((data>>8)&0x01)) != 0){
+			error = 0x3;
+			goto ABORT;
+		}
+		_byteout(bus, (u_int8)data, 1);				/* send second byte		*/
+		if( _clock(bus,1,(u_int8)(data&0x01)) != 0){
+			error = 0x4;
+			goto ABORT;
+		}
+	}
+
+ABORT:
+	_stop(bus);										/* stop condition 		*/
+  	_deselect(bus);									/* deselect B_SEL line 	*/
+
+	return error;
+}
 
- return(wx);
+/******************************* _ackwait *************************************/
+/** Wait for the end of the write cycle by acknowledge polling
+ *
+ *  The device address is sent with the back-off and timeout of the
+ *  default ready polling (see ID_PollConfigSet()) until the EEPROM
+ *  acknowledges it.
+ *
+ *------------------------------------------------------------------------------
+ *  \param  bus    \IN bus access context
+ *  \return 0=ready, 1=timeout
+ *
+ ******************************************************************************/
+static int _ackwait( ID_BUS *bus )
+{
+	ID_WAIT		wait;
+
+	ID_WaitStart( NULL, NULL, &wait );
+
+	while( !_ackpoll( bus ) )
+		if( ID_WaitNext( &wait ) )
+			return 1;
+
+	return 0;
+}
+
+/******************************* _ackpoll *************************************/
+/** Acknowledge polling: send the device address (write)
+ *
+ *------------------------------------------------------------------------------
+ *  \param  bus    \IN bus access context
+ *  \return 1=acknowledged (write cycle done), 0=busy
+ *
+ ******************************************************************************/
+static int _ackpoll( ID_BUS *bus )
+{
+	int		ack;
+
+  	_select(bus);									/* select B_SEL line 	*/
+    _start(bus);									/* start condition 		*/
+   	_opcode(bus, (u_int8)(_WRITE_USM) );			/* opcode for write		*/
+	ack = (_clock(bus,1,0) == 0);					/* release SDA, sample	*/
+	_stop(bus);										/* stop condition 		*/
+  	_deselect(bus);									/* deselect B_SEL line 	*/
+
+	return ack;
 }
 
 /******************************* _opcode **************************************/
@@ -229,12 +689,42 @@ int usm_read( U_INT32_OR_64 base, u_int8 index )
  *  \param  code    \IN opcode to write
  *
  ******************************************************************************/
-static void _opcode( U_INT32_OR_64 base, u_int8 code ) 
+static void _opcode( ID_BUS *bus, u_int8 code ) 
 {
-    register int i;
+    _byteout(bus, code, 0);					/* output instruction code  	*/
+}
 
-    for(i=7; i>=0; i--)						/* output instruction code  	*/
-        _clock(base,(u_int8)((code>>i)&0x01),(u_int8)((code>>(i+1))&0x01) );
+/******************************* _byteout *************************************/
+/** Output a byte (send only), MSB first
+ *
+ *  Same edges as _clockout() per bit, but the line states are replayed
+ *  from G_usmWave nibble by nibble. The data setup write of a bit that
+ *  does not change is skipped (W_SKIP) together with its delay.
+ *
+ *------------------------------------------------------------------------------
+ *  \param  bus     \IN bus access context
+ *  \param  byte    \IN byte to send
+ *  \param  lastdbs \IN data bit currently driven
+ *
+ ******************************************************************************/
+static void _byteout( ID_BUS *bus, u_int8 byte, u_int8 lastdbs )
+{
+    register const u_int8	*st;			/* line states  				*/
+    register int			n;				/* counter      				*/
+
+    st = G_usmWave[lastdbs][byte >> 4];
+    for( n=0; n<12; n++, st++ )
+        if( *st != W_SKIP ){
+            ID_BUS_WRITE_D16( bus, MODREG, *st );
+            _delay();
+        }
+
+    st = G_usmWave[(byte >> 4) & 0x01][byte & 0x0f];
+    for( n=0; n<12; n++, st++ )
+        if( *st != W_SKIP ){
+            ID_BUS_WRITE_D16( bus, MODREG, *st );
+            _delay();
+        }
 }
 
 
@@ -248,14 +738,14 @@ static void _opcode( U_INT32_OR_64 base, u_int8 code )
  *                 output CS high
  *                 delay
  *------------------------------------------------------------------------------
- *  \param base \IN base address pointer
+ *  \param bus  \IN bus access context
  *
  ******************************************************************************/
-static void _select( U_INT32_OR_64 base ) 
+static void _select( ID_BUS *bus ) 
 {
-    MWRITE_D16( base, MODREG, 0 );					/* everything inactive 	*/
+    ID_BUS_WRITE_D16( bus, MODREG, 0 );							/* everything inactive 	*/
     _delay();
-    MWRITE_D16( base, MODREG, (1<<3)|B_CLK|B_SEL );	/* select high 			*/
+    ID_BUS_WRITE_D16( bus, MODREG, (1<<3)|B_CLK|B_SEL );			/* select high 			*/
     										 		/* data bit high 		*/
     _delay();										/* delay 				*/
 }
@@ -263,16 +753,16 @@ static void _select( U_INT32_OR_64 base )
 /******************************* _deselect ************************************/
 /** Deselect EEPROM: output CS low
  *------------------------------------------------------------------------------
- *  \param base \IN base address pointer
+ *  \param bus  \IN bus access context
  *
  ******************************************************************************/
-static void _deselect( U_INT32_OR_64 base ) /* nodoc */
+static void _deselect( ID_BUS *bus ) /* nodoc */
 {
-    MWRITE_D16( base, MODREG, 0 );					/* everything inactive 	*/
+    ID_BUS_WRITE_D16( bus, MODREG, 0 );							/* everything inactive 	*/
 }
 
-/******************************* _clock ***************************************/
-/** Output data bit:
+/******************************* _clockout ************************************/
+/** Output data bit (send only):
  *                 output clock low
  *                 output lastdata bit high/low
  *                 delay
@@ -282,27 +772,48 @@ static void _deselect( U_INT32_OR_64 base ) /* nodoc */
  *                 output clock high
  *                 output data bit high/low
  *                 delay
- *                 return state of data serial eeprom's SDA - line
  *                 (Note: keep CS asserted)
+ *                 If the data bit does not change, the second clock
+ *                 low phase is skipped: there is no data transition
+ *                 that needs hold and setup time and the low time of
+ *                 one delay is kept.
  *------------------------------------------------------------------------------
- *  \param base    \IN base address pointer
+ *  \param bus     \IN bus access context
  *  \param dbs	   \IN data bit to send
  *  \param lastdbs \IN previus data bit to send
- *  \return current data bit
  *
  ******************************************************************************/
-static int _clock( U_INT32_OR_64 base, u_int8 dbs, u_int8 lastdbs ) 
+static void _clockout( ID_BUS *bus, u_int8 dbs, u_int8 lastdbs ) 
 {
-	MWRITE_D16( base, MODREG, (lastdbs<<3)|B_SEL ); /* output clock low 	*/
+	ID_BUS_WRITE_D16( bus, MODREG, (lastdbs<<3)|B_SEL );         /* output clock low 	*/
                                             		/* output data high/low */
     _delay();                          				/* delay    			*/
-	MWRITE_D16( base, MODREG, (dbs<<3)|B_SEL ); 	/* output clock low 	*/
+	if( dbs != lastdbs ){
+		ID_BUS_WRITE_D16( bus, MODREG, (dbs<<3)|B_SEL ); 		/* output clock low 	*/
                                             		/* output data high/low */
-    _delay();                              			/* delay    			*/
-   MWRITE_D16( base, MODREG, (dbs<<3)|B_CLK|B_SEL );  /* output clock high */
+		_delay();                              		/* delay    			*/
+	}
+   ID_BUS_WRITE_D16( bus, MODREG, (dbs<<3)|B_CLK|B_SEL );          /* output clock high */
     _delay();                               		/* delay    			*/
+}
+
+/******************************* _clock ***************************************/
+/** Output data bit and sample SDA:
+ *                 see _clockout()
+ *                 return state of data serial eeprom's SDA - line
+ *                 (Note: keep CS asserted)
+ *------------------------------------------------------------------------------
+ *  \param bus     \IN bus access context
+ *  \param dbs	   \IN data bit to send
+ *  \param lastdbs \IN previus data bit to send
+ *  \return current data bit
+ *
+ ******************************************************************************/
+static int _clock( ID_BUS *bus, u_int8 dbs, u_int8 lastdbs ) 
+{
+	_clockout( bus, dbs, lastdbs );
 
-    return((MREAD_D16( base, MODREG) & B_DAT )>>3);	/* get data bit 		*/
+    return((ID_BUS_READ_D16( bus, MODREG ) & B_DAT )>>3);	/* get data bit 		*/
 }
 
 /******************************* _start ***************************************/
@@ -319,20 +830,20 @@ static int _clock( U_INT32_OR_64 base, u_int8 dbs, u_int8 lastdbs )
  *                 return state of data serial eeprom's SDA - line
  *                 (Note: keep CS asserted)
  *------------------------------------------------------------------------------
- *  \param base \IN base address pointer
+ *  \param bus  \IN bus access context
  *
  ******************************************************************************/
-static void _start( U_INT32_OR_64 base ) 				
+static void _start( ID_BUS *bus ) 				
 {
-	MWRITE_D16( base, MODREG, (1<<3)|B_SEL );  	/* output clock hihg */
+	ID_BUS_WRITE_D16( bus, MODREG, (1<<3)|B_SEL );  			/* output clock hihg */
                                             	/* output data low */
     _delay();                               	/* delay    */
     _delay();                               	/* delay    */
-    MWRITE_D16( base, MODREG, (1<<3)|B_CLK|B_SEL );  	/* output clock hihg */
+    ID_BUS_WRITE_D16( bus, MODREG, (1<<3)|B_CLK|B_SEL );  			/* output clock hihg */
                                             	/* output data low */
     _delay();                               	/* delay    */
     _delay();                               	/* delay    */
-    MWRITE_D16( base, MODREG, B_CLK|B_SEL );  	/* output clock hihg */
+    ID_BUS_WRITE_D16( bus, MODREG, B_CLK|B_SEL );  			/* output clock hihg */
                                             	/* output data low */
     _delay();                               	/* delay    */
     _delay();                               	/* delay    */
@@ -354,32 +865,29 @@ static void _start( U_INT32_OR_64 base )
  *                 delay
  *                 (Note: keep CS asserted)
  *------------------------------------------------------------------------------
- *   \param base \IN base address pointer
+ *   \param bus  \IN bus access context
  *
  ******************************************************************************/
-static void _stop( U_INT32_OR_64 base ) 				
+static void _stop( ID_BUS *bus ) 				
 {
-    MWRITE_D16( base, MODREG, B_SEL );  		/* output data/clock low */
+    ID_BUS_WRITE_D16( bus, MODREG, B_SEL );  				/* output data/clock low */
     _delay();                               	/* delay    */
-    MWRITE_D16( base, MODREG, B_CLK|B_SEL );  	/* output clock high */
+    ID_BUS_WRITE_D16( bus, MODREG, B_CLK|B_SEL );  			/* output clock high */
                                             	/* output data low */
     _delay();                               	/* delay    */
-    MWRITE_D16( base, MODREG, (1<<3)|B_CLK|B_SEL );  /* output data/clock high */
+    ID_BUS_WRITE_D16( bus, MODREG, (1<<3)|B_CLK|B_SEL );          /* output data/clock high */
     _delay();                               	/* delay    */
-    MWRITE_D16( base, MODREG, (1<<3)|B_SEL );  	/* output data high */
+    ID_BUS_WRITE_D16( bus, MODREG, (1<<3)|B_SEL );  			/* output data high */
     _delay();                               	/* delay    */
 }
 
 /******************************* _delay ***************************************/
-/** Delay (at least) one microsecond
+/** Delay one bit phase (calibrated, see id_time.c)
  *------------------------------------------------------------------------------
  *
  ******************************************************************************/
 static void _delay( void ) 
 {
-    register volatile int i,n;
-
-  	for(i=DELAY; i>0; i--)
-        n=10*10;
+    ID_DelayNs( ID_T_USM_HALF_NS );
 }
 